@@ -18,6 +18,9 @@
 #define PICC_REQIDL    0x26
 #define PICC_REQALL    0x52
 #define PICC_ANTICOLL  0x93
+#define PICC_ANTICOLL2 0x95
+#define PICC_ANTICOLL3 0x97
+#define PICC_CT        0x88   // Cascade tag, more UID bytes on the next level
 #define PICC_SELC      0x93
 #define PICC_AUTH1A    0x60
 #define PICC_AUTH1B    0x61
@@ -25,6 +28,17 @@
 #define PICC_WRITE     0xA0
 #define PICC_HALT      0x50
 
+#define MFRC522_FIFO_SIZE 64   // Bytes, also the longest SPI burst
+
+/* Command timeouts, the chip timer ends a transceive after 25 ms */
+#define MFRC522_CMD_TIMEOUT_MS 40
+#define MFRC522_CRC_TIMEOUT_MS 2
+#define MFRC522_SPI_TIMEOUT_MS 10
+
+/* With use_dma, transfers of at least this many bytes and register scripts
+ * run on DMA. A single register access is cheaper to clock out by hand. */
+#define MFRC522_DMA_MIN_LEN 4
+
 /* Status Enumerations */
 typedef enum {
     MFRC522_OK = 0,
@@ -32,6 +46,21 @@ typedef enum {
     MFRC522_TIMEOUT
 } MFRC522_Status;
 
+/* SPI DMA transfer state */
+typedef enum {
+    MFRC522_DMA_IDLE = 0,
+    MFRC522_DMA_BUSY,
+    MFRC522_DMA_DONE,
+    MFRC522_DMA_ERROR
+} MFRC522_DmaState;
+
+/* CRC_A source for SELECT, READ, WRITE and HALT frames */
+typedef enum {
+    MFRC522_CRC_TABLE = 0,  // Lookup table on the MCU, no bus traffic
+    MFRC522_CRC_CHIP,       // CalcCRC command, a FIFO round trip per frame
+    MFRC522_CRC_FRAME       // TxCRCEn/RxCRCEn, appended and checked on air by the chip
+} MFRC522_CrcMode;
+
 /* UID Struct */
 typedef struct {
     uint8_t size;
@@ -51,6 +80,14 @@ typedef struct {
     uint16_t cs_pin;
     GPIO_TypeDef *rst_port;
     uint16_t rst_pin;
+    GPIO_TypeDef *irq_port;         // IRQ pin on an EXTI line, NULL = poll the IRQ registers
+    uint16_t irq_pin;
+    volatile uint8_t irq_pending;   // Set by MFRC522_IrqCallback()
+    uint8_t use_dma;                // FIFO bursts and register scripts on the DMA channels of hspi
+    volatile uint8_t dma_state;     // MFRC522_DmaState, advanced by MFRC522_DmaCallback()
+    uint8_t *dma_next;              // Next CS window of a running register script
+    uint8_t crc_mode;               // MFRC522_CrcMode, may change between commands
+    uint8_t crc_regs;               // TxCRCEn/RxCRCEn as last written
     MFRC522_UID uid;
 } MFRC522_HandleTypeDef;
 
@@ -63,5 +100,8 @@ MFRC522_Status MFRC522_ReadBlock(MFRC522_HandleTypeDef *dev, uint8_t blockAddr,
 MFRC522_Status MFRC522_WriteBlock(MFRC522_HandleTypeDef *dev, uint8_t blockAddr, uint8_t *buffer);
 void MFRC522_Halt(MFRC522_HandleTypeDef *dev);
 void MFRC522_StopCrypto1(MFRC522_HandleTypeDef *dev);
+void MFRC522_IrqCallback(MFRC522_HandleTypeDef *dev);
+void MFRC522_DmaCallback(MFRC522_HandleTypeDef *dev, bool ok);
+uint16_t MFRC522_CrcA(const uint8_t *data, uint8_t len);
 
 #endif
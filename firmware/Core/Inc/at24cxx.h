@@ -1,13 +1,30 @@
 /**
   ******************************************************************************
   * @file    at24cxx.h
-  * @brief   This file contains all the constants parameters for the AT24C32/64
-  *          EEPROM
+  * @brief   This file contains all the constants parameters for the
+  *          AT24C32 to AT24C512 EEPROM
   * @Date	 21 Jul 2021
   ******************************************************************************
   * @attention
   * Usage:
-  *		Uncomment LL Driver for HAL driver
+  *		The blocking transfers run on the HAL (HAL_I2C_Mem_Read/Write) or on
+  *		a register level LL backend, both on hi2c2 / I2C2 and both with
+  *		bounded waits. AT24Cxx_SetBackend() switches at runtime, LL_Driver
+  *		selects the LL backend at boot.
+  *		The asynchronous API queues page writes on HAL I2C DMA and
+  *		waits for the write cycle from AT24Cxx_Poll(), call it from the
+  *		superloop. Buffers must stay valid until the callback has run.
+  *		The blocking functions drain the queue first.
+  *		AT24Cxx_Detect() probes the attached density at boot; until then
+  *		the driver assumes the AT24C32 geometry below.
+  *		Several devices of the same type can share the bus: list their
+  *		addresses in AT24Cxx_DEV_ADDRESSES and pages are striped round robin
+  *		over them. Memory addresses then span all devices (page n is page
+  *		n / AT24Cxx_DEV_NUM of device n % AT24Cxx_DEV_NUM) and a page write
+  *		overlaps the write cycle of the previous device.
+  *		AT24Cxx_EraseStart() erases a range in the background: each
+  *		AT24Cxx_EraseStep() starts at most one page write, so a superloop
+  *		slice never stalls for long. AT24Cxx_EraseLeft() gives the progress.
   *
   ******************************************************************************
   */
@@ -22,27 +39,75 @@
 /* Includes ------------------------------------------------------------------*/
 #include <string.h>
 #include "main.h"
-#include "math.h"
+#include "stm32f0xx_ll_i2c.h"
  extern I2C_HandleTypeDef hi2c2;
 /* Driver Selection ----------------------------------------------------------*/
-//#define LL_Driver
-#ifdef LL_Driver
-#define I2Cx					I2C1
-#else
-#define I2Cx					(&hi2c2)
-#endif
+//#define LL_Driver						// Boot with the LL backend
+#define AT24Cxx_I2C				(&hi2c2)	// HAL handle, also used for DMA
+#define AT24Cxx_LL_I2C			I2C2		// Same peripheral for the LL backend
+#define AT24Cxx_LL_TIMEOUT		2		// Max wait for one bus flag in ms
+
+typedef enum {
+	AT24Cxx_BACKEND_HAL = 0,
+	AT24Cxx_BACKEND_LL
+} AT24Cxx_Backend;
 
 /* AT24Cxx Register ----------------------------------------------------------*/
 #define AT24Cxx_ADDRESS 		0xAE	// ZS-042 AT24C32 default address
-#define AT24Cxx_EEPROM_SIZE		0x1000	// EEPROM Size 4096 byte
-#define AT24Cxx_PAGE_SIZE		0x20	// Page size 32 byte
-#define AT24Cxx_PAGE_NUM		0x80	// Number of page 128
+#define AT24Cxx_EEPROM_SIZE		0x1000	// Default size 4096 byte (AT24C32)
+#define AT24Cxx_PAGE_SIZE		0x20	// Smallest page size 32 byte
+#define AT24Cxx_PAGE_NUM		0x80	// Default number of page 128
+#define AT24Cxx_EEPROM_SIZE_MAX	0x10000	// AT24C512
+#define AT24Cxx_PAGE_SIZE_MAX	0x80	// AT24C512 page size 128 byte
+#define AT24Cxx_WRITE_TIMEOUT	10		// Max write cycle time in ms (tWR)
+
+/* AT24Cxx Striping ----------------------------------------------------------*/
+#define AT24Cxx_DEV_NUM			1		// Up to 8, e.g. 2 with { 0xAE, 0xAC }
+#define AT24Cxx_DEV_ADDRESSES	{ AT24Cxx_ADDRESS }
+
+/* AT24Cxx Write Cycle Statistics --------------------------------------------*/
+typedef struct {
+	uint32_t LastUs;		// Write cycle time of the last page write
+	uint32_t MinUs;
+	uint32_t MaxUs;
+	uint32_t TotalUs;		// Sum over Count page writes
+	uint32_t Count;
+	uint32_t Timeouts;		// Device never acknowledged within the timeout
+} AT24Cxx_WriteStats;
+
+/* AT24Cxx Asynchronous Request Queue ----------------------------------------*/
+#define AT24Cxx_QUEUE_LEN		4		// Pending asynchronous requests
+#define AT24Cxx_XFER_TIMEOUT	50		// Max HAL/DMA transfer time in ms
+
+/* Status = 0 on success, 1 on bus error or write cycle timeout */
+typedef void (*AT24Cxx_Callback)(uint8_t Status, void *Context);
 
 /* AT24Cxx External Function -------------------------------------------------*/
+void AT24Cxx_SetBackend(AT24Cxx_Backend Backend);
+AT24Cxx_Backend AT24Cxx_GetBackend(void);
+uint8_t AT24Cxx_Detect(uint16_t ScratchAddr);
+void AT24Cxx_SetSize(uint32_t Size);
+uint32_t AT24Cxx_DeviceSize(void);
+uint32_t AT24Cxx_Size(void);
+uint16_t AT24Cxx_PageSize(void);
 uint8_t AT24Cxx_EraseChip(void);
+uint8_t AT24Cxx_EraseStart(uint16_t MemAddr, uint32_t Len);
+void AT24Cxx_EraseLimit(uint16_t MemAddr);
+uint8_t AT24Cxx_EraseStep(void);
+uint32_t AT24Cxx_EraseLeft(void);
 uint8_t AT24Cxx_FillPage(uint16_t Page, uint8_t Val);
+uint8_t AT24Cxx_Fill(uint16_t MemAddr, uint8_t Value, uint32_t Len);
 uint8_t AT24Cxx_ReadByte(uint16_t MemAddr, uint8_t *pData, uint16_t Len);
 uint8_t AT24Cxx_WriteByte(uint16_t MemAddr, uint8_t *value, uint16_t Len);
+uint8_t AT24Cxx_WaitReady(uint16_t DevAddr);
+const AT24Cxx_WriteStats *AT24Cxx_GetWriteStats(void);
+uint8_t AT24Cxx_WriteAsync(uint16_t MemAddr, uint8_t *pData, uint16_t Len,
+		AT24Cxx_Callback Callback, void *Context);
+uint8_t AT24Cxx_ReadAsync(uint16_t MemAddr, uint8_t *pData, uint16_t Len,
+		AT24Cxx_Callback Callback, void *Context);
+void AT24Cxx_Poll(void);
+uint8_t AT24Cxx_IsIdle(void);
+void AT24Cxx_Sync(void);
 
 #ifdef __cplusplus
 }
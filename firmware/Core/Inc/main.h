@@ -53,6 +53,7 @@ extern "C" {
 void Error_Handler(void);
 
 /* USER CODE BEGIN EFP */
+void I2C2_WaitIdle(void);
 
 /* USER CODE END EFP */
 
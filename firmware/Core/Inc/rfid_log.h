@@ -0,0 +1,173 @@
+/**
+  ******************************************************************************
+  * @file    rfid_log.h
+  * @brief   Attendance log stored in the AT24Cxx EEPROM
+  ******************************************************************************
+  * @attention
+  * Usage:
+  *		Appended records are collected in a RAM staging buffer and written
+  *		back in whole EEPROM pages. A partially filled page stays in RAM
+  *		until RFIDLOG_FLUSH_LATENCY_MS expires or RFIDLog_Flush() is called
+  *		(idle, before browsing the log). Write-backs run on the asynchronous
+  *		AT24Cxx queue; RFIDLog_Sync() also waits for them (power-fail).
+  *		Call RFIDLog_Poll() and AT24Cxx_Poll() from the superloop.
+  *		RFIDLog_Init() converts a log in the legacy 12 byte layout and finds
+  *		the head by bisection over the record laps, so an append costs one
+  *		page write and the header is only rewritten on wrap or clear.
+  *		Records and header copies carry a CRC-8; a page torn by a reset is
+  *		detected at boot and the head moved back below it.
+  *		RFIDLog_Init() fails and writes nothing if the header or the ring
+  *		cannot be read, or the size of a new EEPROM probed, after
+  *		RFIDLOG_READ_RETRIES attempts; a bus error is never taken for a
+  *		blank or legacy EEPROM, nor for a small one. Call it again.
+  *		The log is a ring: once full, every append evicts the oldest record.
+  *		Log indexes (0 = oldest) shift on eviction, ring slots do not; keep
+  *		a slot (RFIDLog_Slot(), RFIDLog_Append()) to refer to a record later.
+  *		RFIDLog_SetEvictHandler() reports records before they are overwritten.
+  *		RFIDLog_Clear() only moves the log start in the header; records of
+  *		the earlier generation stay in place until the ring reuses them.
+  *		RFIDLog_Wipe() also erases them, one page per RFIDLog_Maintain().
+  *		With RFIDLOG_COMPACT an event takes 4 bytes instead of 16 and the
+  *		UID is kept once in the roster; reads decode back to RFID_Record.
+  *		RFIDLog_Maintain() erases roster entries no event of the log refers
+  *		to any more. Until it has, a new UID finds the roster full and
+  *		RFIDLog_Append() returns RFIDLOG_NO_SLOT.
+  *		Filler slots of the compact layout read as 2. Switching layouts
+  *		formats the log, a legacy log is only converted to 16 byte records.
+  *		Scans go through RFIDLog_Begin() / RFIDLog_Next(), which read
+  *		whole blocks in bursts instead of one transaction per record.
+  *		Single reads go through a small LRU cache; RFIDLog_Read() queues
+  *		the next line in the browsing direction, so PREV/NEXT mostly hit.
+  *		RFIDLog_BeginDay() scans the records of one day only: a day index at
+  *		the end of the EEPROM gets an entry whenever a later day starts.
+  *		RFIDLog_FindUID() answers whether a UID is in the log with a binary
+  *		search over a sorted UID directory, about log2(n) small reads.
+  *		RFIDLog_Maintain() enters the new records, one record or one page
+  *		of moved entries per call; appends never touch the directory.
+  *		A directory that ran full is rebuilt once, if it is still full it
+  *		is no longer complete until the next RFIDLog_Clear(). Lookups
+  *		report 2 then, while more than RFIDLOG_DIR_PENDING records wait,
+  *		during a rebuild and on EEPROMs too small to have a directory; the
+  *		caller scans the log.
+  *		Once less than 1/RFIDLOG_ROLLUP_FREE of the ring is free,
+  *		RFIDLog_Maintain() rolls the oldest completed day up into daily
+  *		summaries (first and last tap per UID, 16 byte each) and moves the
+  *		log start past its records, in one pass of RFIDLOG_ROLLUP_STEP
+  *		records per call. Each batch of RFIDLOG_ROLLUP_BATCH UIDs is
+  *		written as it fills, so a busy day leaves several entries per UID.
+  *		Once half the reserve is used up it rolls up the running day too.
+  *		Records the ring is about to overwrite anyway are rolled up by
+  *		RFIDLog_Append() first, only those, so no day is lost.
+  *		RFIDLog_BeginSummary() / RFIDLog_NextSummary() scan them by date.
+  *		Summaries survive RFIDLog_Clear() and RFIDLog_Wipe().
+  *		The log spans the whole EEPROM: RFIDLog_Init() probes its size once
+  *		(AT24Cxx_Detect()) and keeps it in the header.
+  *
+  ******************************************************************************
+  */
+#ifndef RFID_LOG_H
+#define RFID_LOG_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "main.h"
+#include "at24cxx.h"
+#include "rfid_record.h"
+
+/* Log Layout ----------------------------------------------------------------*/
+//#define RFIDLOG_COMPACT				// Compact blocks, see rfid_record.h
+#define RFIDLOG_PROBE_ADDR		(RFIDLOG_HEADER_ADDR + 14)	// Geometry byte of copy 0
+
+/* Region sizes are part of the EEPROM format, see rfid_record.h */
+#define RFIDLOG_ROLLUP_FREE		4		// Roll up once less than 1/n of the ring is free
+#define RFIDLOG_ROLLUP_BATCH	16		// UIDs a roll-up batch holds (RAM, 16 byte each)
+#define RFIDLOG_ROLLUP_SPAN		64		// Records a batch summarises at most
+#define RFIDLOG_ROLLUP_STEP		16		// Records read per roll-up step
+#define RFIDLOG_ROSTER_RECLAIM	8		// Reclaim once less than 1/n of the roster is left
+
+#define RFIDLOG_DIR_PENDING		16		// Records RFIDLog_FindUID() checks one by one
+
+#define RFIDLOG_NO_SLOT			0xFFFF	// Append failed, roster full of UIDs in the log
+
+/* Called by RFIDLog_Append() for each record it is about to overwrite */
+typedef void (*RFIDLog_EvictFn)(uint16_t slot, const RFID_Record *rec);
+
+/* Staging Buffer ------------------------------------------------------------*/
+/* A whole page of the largest device plus what one append stages */
+#define RFIDLOG_STAGE_SIZE		(AT24Cxx_PAGE_SIZE_MAX + RFIDLOG_RING_BLOCK)	// RAM bytes
+#define RFIDLOG_FLUSH_LATENCY_MS	2000	// Max age of an unwritten record
+
+/* Read Cache ----------------------------------------------------------------*/
+#define RFIDLOG_READ_RETRIES	3		// Attempts at a boot read before RFIDLog_Init() fails
+#define RFIDLOG_CACHE_LINES		4		// LRU lines for RFIDLog_Read()/ReadAt()
+#define RFIDLOG_CACHE_LINE		64		// Bytes per line, two blocks
+
+/* Log Iterator --------------------------------------------------------------*/
+#define RFIDLOG_ITER_SIZE		128		// Burst read, whole 32 byte blocks
+#define RFIDLOG_ITER_END		0xFF	// RFIDLog_Next(): no record left
+#define RFIDLOG_ANY_DATE		0xFFFF	// Scan not limited to one day
+
+typedef struct {
+	uint32_t seq;				// Sequence number of the next record
+	uint32_t end;				// Head when the scan started
+	uint16_t slot;				// Ring slot of the record returned last
+	uint16_t date;				// RFIDLog_BeginDay() date or RFIDLOG_ANY_DATE
+	uint16_t bufAddr;			// EEPROM address of buf[0]
+	uint16_t bufLen;
+	uint8_t  buf[RFIDLOG_ITER_SIZE];
+} RFIDLog_Iter;
+
+/* Daily Summaries -----------------------------------------------------------*/
+typedef struct {
+	uint8_t  uid[RFIDREC_UID_MAX];
+	uint8_t  uidSize;
+	uint16_t date;				// Days since 2000-01-01
+	uint32_t first;				// RFIDREC_STAMP() of the first tap, seconds 0
+	uint32_t last;				// RFIDREC_STAMP() of the last tap, seconds 0
+} RFIDLog_Summary;
+
+typedef struct {
+	uint16_t pos;				// Blocks from the oldest one
+	uint16_t count;				// Blocks in the scan
+	uint16_t oldest;			// Ring index of the oldest block
+	uint16_t to;				// Last date of the scan
+	uint16_t bufPos;			// pos of buf[0]
+	uint8_t  bufBlocks;
+	uint8_t  entry;				// Next entry of the block at pos
+	uint8_t  buf[RFIDLOG_ITER_SIZE];
+} RFIDLog_SumIter;
+
+/* RFID Log External Function ------------------------------------------------*/
+uint8_t RFIDLog_Init(void);
+uint16_t RFIDLog_Count(void);
+uint16_t RFIDLog_Capacity(void);
+uint16_t RFIDLog_Slot(uint16_t index);
+uint8_t RFIDLog_Read(uint16_t index, RFID_Record *rec);
+uint8_t RFIDLog_ReadAt(uint16_t slot, RFID_Record *rec);
+void RFIDLog_Begin(RFIDLog_Iter *it);
+uint8_t RFIDLog_BeginDay(RFIDLog_Iter *it, uint32_t stamp);
+uint8_t RFIDLog_Next(RFIDLog_Iter *it, RFID_Record *rec);
+uint16_t RFIDLog_Append(const RFID_Record *rec);
+uint8_t RFIDLog_FindUID(const uint8_t *uid, uint8_t uidSize, uint16_t *slot);
+void RFIDLog_MakeRecord(RFID_Record *rec, const uint8_t *uid, uint8_t uidSize,
+		uint8_t status, uint32_t stamp);
+void RFIDLog_BeginSummary(RFIDLog_SumIter *it, uint32_t from, uint32_t to);
+uint8_t RFIDLog_NextSummary(RFIDLog_SumIter *it, RFIDLog_Summary *sum);
+uint16_t RFIDLog_SummaryCapacity(void);
+uint8_t RFIDLog_Clear(void);
+uint8_t RFIDLog_Wipe(void);
+uint8_t RFIDLog_Maintain(void);
+uint8_t RFIDLog_Flush(void);
+uint8_t RFIDLog_Sync(void);
+uint16_t RFIDLog_WriteErrors(void);
+uint16_t RFIDLog_Recovered(void);
+void RFIDLog_SetEvictHandler(RFIDLog_EvictFn fn);
+void RFIDLog_Poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* RFID_LOG_H */
@@ -0,0 +1,538 @@
+/**
+  ******************************************************************************
+  * @file    rfid_record.h
+  * @brief   On-EEPROM format of the attendance log
+  ******************************************************************************
+  * @attention
+  * Usage:
+  *		Plain C, depends on <stdint.h> only so host tools (tools/rfidlog)
+  *		decode EEPROM images with the same definitions as the firmware,
+  *		the region layout included.
+  *
+  *		Records are 16 bytes and naturally aligned, two records fill one
+  *		32 byte page and no record straddles a page boundary.
+  *
+  ******************************************************************************
+  */
+#ifndef RFID_RECORD_H
+#define RFID_RECORD_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Log Record ----------------------------------------------------------------*/
+typedef struct {
+    uint8_t  info;		// Format byte, see RFIDREC_INFO_*
+    uint8_t  crc;		// CRC-8 over the other 15 bytes
+    uint8_t  uid[10];	// Full length UID, zero padded
+    uint32_t stamp;		// Packed date and time, see RFIDREC_STAMP()
+} RFID_Record;
+
+#define RFIDREC_SIZE			16
+#define RFIDREC_UID_MAX			10
+
+/* Format byte: version[7:6] | lap[5:4] | status[3:2] | UID size[1:0]
+ * Version 0 (all zero) and 3 (erased 0xFF) never describe a valid record,
+ * nor does UID size code 3 (13 bytes, longer than RFIDREC_UID_MAX).
+ * The lap is the low two bits of the header pass the record was written in. */
+#define RFIDREC_VERSION			1
+#define RFIDREC_INFO(status, uidSize)	((uint8_t)((RFIDREC_VERSION << 6) | \
+		(((status) & 0x03) << 2) | RFIDREC_UID_CODE(uidSize)))
+#define RFIDREC_INFO_VERSION(info)		(((info) >> 6) & 0x03)
+#define RFIDREC_INFO_LAP(info)			(((info) >> 4) & 0x03)
+#define RFIDREC_INFO_WITH_LAP(info, pass)	((uint8_t)(((info) & 0xCF) | \
+		(((pass) & 0x03) << 4)))
+#define RFIDREC_INFO_STATUS(info)		(((info) >> 2) & 0x03)
+#define RFIDREC_INFO_UID_SIZE(info)		(4 + (3 * ((info) & 0x03)))
+#define RFIDREC_UID_CODE_MAX			2
+
+/* Single, double and triple size UIDs (ISO/IEC 14443-3) */
+#define RFIDREC_UID_CODE(uidSize)		((uidSize) >= 10 ? 2 : ((uidSize) >= 7 ? 1 : 0))
+
+/* Stamp: year-2000[31:26] | month[25:22] | day[21:17] | hour[16:12] |
+ * minute[11:6] | second[5:0]. Later stamps compare greater. */
+#define RFIDREC_STAMP(y, mo, d, h, mi, s)	((uint32_t)( \
+		((uint32_t)((y) & 0x3F) << 26) | ((uint32_t)((mo) & 0x0F) << 22) | \
+		((uint32_t)((d) & 0x1F) << 17) | ((uint32_t)((h) & 0x1F) << 12) | \
+		((uint32_t)((mi) & 0x3F) << 6) | ((uint32_t)(s) & 0x3F)))
+#define RFIDREC_YEAR(stamp)		(((stamp) >> 26) & 0x3F)
+#define RFIDREC_MONTH(stamp)	(((stamp) >> 22) & 0x0F)
+#define RFIDREC_DAY(stamp)		(((stamp) >> 17) & 0x1F)
+#define RFIDREC_HOUR(stamp)		(((stamp) >> 12) & 0x1F)
+#define RFIDREC_MINUTE(stamp)	(((stamp) >> 6) & 0x3F)
+#define RFIDREC_SECOND(stamp)	((stamp) & 0x3F)
+
+/* Log Header (page 0) -------------------------------------------------------*/
+/* Records live in a ring of slots after the header. Slot s written during
+ * pass p has sequence number p * capacity + s and carries lap p & 3. The
+ * slots written in the current pass form a prefix of the ring, so the head
+ * is found by bisection and appending never touches the header. The header
+ * is only rewritten when the ring wraps or the log is cleared.
+ * Page 0 holds two header copies. Updates alternate between them, so a torn
+ * header write always leaves the previous copy intact. */
+typedef struct {
+    uint32_t magic;			// RFIDLOG_MAGIC
+    uint8_t  layout;		// RFIDLOG_LAYOUT
+    uint8_t  recordSize;	// RFIDREC_SIZE
+    uint16_t pass;			// Passes over the ring so far
+    uint32_t start;			// Sequence number of the oldest record in the log
+    uint16_t update;		// Write counter, the higher valid copy is current
+    uint8_t  geometry;		// RFIDLOG_GEOMETRY(), 0 = not probed yet
+    uint8_t  crc;			// CRC-8 over the first 15 bytes
+} RFIDLog_Header;
+
+#define RFIDLOG_MAGIC			0x474F4C52UL	// "RLOG"
+#define RFIDLOG_LAYOUT			12		// 16 byte RFID_Record slots, page aligned regions
+#define RFIDLOG_LAYOUT_COMPACT	13		// Compact blocks, recordSize = 4
+#define RFIDLOG_HEADER_ADDR		0x0000	// Copy 0, copy 1 follows
+#define RFIDLOG_HEADER_SIZE		16
+#define RFIDLOG_HEADER_COPIES	2
+#define RFIDLOG_BASE_ADDR		0x0020	// First record slot, page 1
+
+/* Geometry: log2 of the device size [4:0], striped devices - 1 [7:5] */
+#define RFIDLOG_GEOMETRY(bits, devices)	((bits) | (((devices) - 1) << 5))
+#define RFIDLOG_GEOMETRY_BITS(geo)		((geo) & 0x1F)
+#define RFIDLOG_GEOMETRY_DEVICES(geo)	((((geo) >> 5) & 0x07) + 1)
+
+/* Day Index -----------------------------------------------------------------*/
+/* A small ring of entries between the UID directory and the end of the EEPROM
+ * (the roster in the compact layout). An entry is written when the first
+ * record of a later day is appended and holds that record's sequence number;
+ * the day's records run up to the sequence number of the next entry. Dates
+ * and sequence numbers only grow, the valid entry with the highest sequence
+ * number is the newest. */
+typedef struct {
+    uint16_t date;			// Days since 2000-01-01, see RFIDRec_StampToDate()
+    uint8_t  crc;			// CRC-8 over the other 7 bytes
+    uint8_t  reserved;
+    uint32_t seq;			// Sequence number of the day's first record
+} RFIDLog_DayEntry;
+
+#define RFIDLOG_DAY_SIZE		8
+
+/* UID Directory -------------------------------------------------------------*/
+/* Entries sorted by UID (zero padded bytes, then size) in front of the day
+ * index, the valid entries form a prefix. An entry names the ring slot of
+ * the newest record of its UID; a slot that has been overwritten since no
+ * longer matches the UID, so eviction needs no directory update. Inserting
+ * moves the entries above up by one, the last one first. */
+typedef struct {
+    uint8_t  info;			// RFIDREC_INFO() of the UID size, status zero
+    uint8_t  crc;			// CRC-8 over the other 15 bytes
+    uint8_t  uid[10];		// Full length UID, zero padded
+    uint16_t slot;			// Ring slot of the newest record of the UID
+    uint16_t reserved;
+} RFIDLog_DirEntry;
+
+#define RFIDLOG_DIR_ENTRY_SIZE	16
+
+/* Daily Summaries -----------------------------------------------------------*/
+/* A ring of 32 byte blocks between the record ring and the UID directory.
+ * Rolling up a day of the log leaves one entry per UID with the minutes of
+ * its first and last tap; a block holds two entries of the same date. Blocks
+ * written in the current lap form a prefix of the ring, block 0 carries that
+ * lap. Blocks follow the log order, so dates only grow unless the clock was
+ * set back. A UID can have several entries of a date (day rolled up in
+ * parts or in more than one batch); its first and last tap are the
+ * earliest and latest over them. */
+typedef struct {
+    uint8_t  uid[10];		// Full length UID, zero padded
+    uint16_t first;			// UID size code[15:14] | minute of the day[10:0]
+    uint16_t last;			// Minute of the day of the last tap
+} RFIDLog_SumEntry;
+
+typedef struct {
+    uint8_t  info;			// Version RFIDSUM_VERSION and lap, like a record
+    uint8_t  crc;			// CRC-8 over the other 31 bytes
+    uint16_t date;			// Days since 2000-01-01, see RFIDRec_StampToDate()
+    RFIDLog_SumEntry entry[2];
+} RFIDLog_SumBlock;
+
+#define RFIDSUM_VERSION			1		// Own region, shared with the record version
+#define RFIDSUM_BLOCK_SIZE		32
+#define RFIDSUM_ENTRY_SIZE		14
+#define RFIDSUM_ENTRIES			2
+#define RFIDSUM_VOID			0xFFFF	// Unused entry of a block (first)
+#define RFIDSUM_FIRST(uidSize, minute)	((uint16_t)((RFIDREC_UID_CODE(uidSize) \
+		<< 14) | ((minute) & 0x7FF)))
+#define RFIDSUM_UID_SIZE(first)			RFIDREC_INFO_UID_SIZE((first) >> 14)
+#define RFIDSUM_MINUTE(first)			((first) & 0x7FF)
+
+/* Compact Layout ------------------------------------------------------------*/
+/* The ring holds 32 byte blocks: an 8 byte base with the stamp of the first
+ * event, then six 4 byte events. An event names the UID by its index in the
+ * roster (a table of RFID_Record entries at the end of the EEPROM, stamp =
+ * first seen) and stores the seconds since the previous event of the block.
+ * A gap the delta cannot hold starts a new block; the rest of the old block
+ * is filled with void events so the written slots stay a prefix.
+ *
+ * Event: check[31:27] | delta[26:13] | roster[12:4] | status[3:2] | lap[1:0]
+ * The check is the low 5 bits of the CRC-8 over bits [26:0]. */
+typedef struct {
+    uint8_t  info;			// Version RFIDCMP_VERSION and lap, like a record
+    uint8_t  crc;			// CRC-8 over the other 7 bytes
+    uint16_t reserved;
+    uint32_t stamp;			// RFIDREC_STAMP() of the first event
+} RFID_CompactBase;
+
+#define RFIDCMP_VERSION			2
+#define RFIDCMP_BLOCK_SIZE		32
+#define RFIDCMP_BASE_SIZE		8
+#define RFIDCMP_EVENT_SIZE		4
+#define RFIDCMP_EVENTS			((RFIDCMP_BLOCK_SIZE - RFIDCMP_BASE_SIZE) / RFIDCMP_EVENT_SIZE)
+#define RFIDCMP_ROSTER_VOID		0x1FF	// Filler event, no roster entry
+#define RFIDCMP_DELTA_MAX		0x3FFF	// Seconds, about 4.5 hours
+
+#define RFIDCMP_EVENT_LAP(ev)		((ev) & 0x03)
+#define RFIDCMP_EVENT_STATUS(ev)	(((ev) >> 2) & 0x03)
+#define RFIDCMP_EVENT_ROSTER(ev)	(((ev) >> 4) & 0x1FF)
+#define RFIDCMP_EVENT_DELTA(ev)		(((ev) >> 13) & RFIDCMP_DELTA_MAX)
+
+/* Region Layout -------------------------------------------------------------*/
+/* The log spans the EEPROM up to RFIDLOG_END_MAX. From the end down: the
+ * roster (compact layout only), the day index, the UID directory and the
+ * daily summaries, each a fixed share of the EEPROM up to a maximum entry
+ * count. Every region starts and ends on a device page, so no entry write
+ * straddles a page. The record ring fills the rest after the header page,
+ * so the layout follows from the EEPROM size and page size alone, see
+ * RFIDLog_MakeLayout(). The UID directory is left out if the log cannot
+ * hold more than RFIDLOG_DIR_MIN UIDs: the RAM index of the firmware
+ * (UID_INDEX_MAX_LOAD) then holds every UID of the log. */
+#define RFIDLOG_END_MAX			0xFFE0	// 16 bit addresses, last AT24C512 page unused
+#define RFIDLOG_ROSTER_SIZE		256		// Entries, at most 511 and a quarter
+#define RFIDLOG_DAYS			64		// Day index entries, at most a sixteenth
+#define RFIDLOG_DIR_SIZE		1024	// UID directory entries, at most a quarter
+#define RFIDLOG_DIR_MIN			384		// UIDs the log must exceed for a directory
+#define RFIDLOG_SUM_BLOCKS		512		// Summary blocks, at most a quarter
+#define RFIDLOG_RING_BLOCK		32		// Ring blocks, record pairs or compact blocks
+
+typedef struct {
+    uint16_t endAddr;		// End of the log
+    uint16_t rosterAddr;	// Compact layout, endAddr otherwise
+    uint16_t rosterSize;
+    uint16_t dayAddr;
+    uint16_t daySlots;
+    uint16_t dirAddr;
+    uint16_t dirSlots;
+    uint16_t sumAddr;		// Also the end of the record ring
+    uint16_t sumBlocks;
+    uint16_t blockSlots;	// Record slots per ring block
+    uint16_t capacity;		// Record slots in the ring
+} RFIDLog_Layout;
+
+/* Legacy Layout -------------------------------------------------------------*/
+/* Up to now: 2 byte counter at 0x0000 followed by packed 12 byte records */
+typedef struct __attribute__((packed)) {
+    uint8_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint8_t uid[5];
+    uint8_t status;
+} RFID_LegacyLog;
+
+#define RFIDLOG_LEGACY_COUNT_ADDR	0x0000
+#define RFIDLOG_LEGACY_BASE_ADDR	0x0002
+#define RFIDLOG_LEGACY_SIZE			12
+
+/* Conversion of a legacy log in progress. Two copies, written in turn, hold
+ * the step and how far it got, so a reset resumes exactly there. They sit
+ * where no legacy record that is kept can be: in the slot of the oldest
+ * record if the ring cannot keep all of them (the others are then moved to
+ * start at the next slot), else at the end of the log. The legacy counter
+ * stays untouched until the header replaces it. */
+typedef struct {
+    uint8_t  step;			// RFIDLOG_MIGRATE_SHIFT or RFIDLOG_MIGRATE_CONVERT
+    uint8_t  crc;			// CRC-8 over the other 3 bytes
+    uint16_t done;			// Shift: bytes moved, convert: ring blocks written
+} RFIDLog_MigrateState;
+
+#define RFIDLOG_MIGRATE_SIZE		4
+#define RFIDLOG_MIGRATE_COPIES		2
+#define RFIDLOG_MIGRATE_SHIFT		0x5A	// Moving the kept records down
+#define RFIDLOG_MIGRATE_CONVERT		0xA5	// Writing ring blocks, last one first
+
+/* Checksum ------------------------------------------------------------------*/
+/* CRC-8, polynomial 0x07, continued from crc over len bytes */
+static inline uint8_t RFIDRec_Crc8(uint8_t crc, const void *data, uint8_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        crc ^= p[i];
+        for (uint8_t b = 0; b < 8; b++)
+        {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/* Record CRC covers every byte except crc itself */
+static inline uint8_t RFIDRec_Checksum(const RFID_Record *rec)
+{
+    const uint8_t *p = (const uint8_t *)rec;
+
+    return RFIDRec_Crc8(RFIDRec_Crc8(0, p, 1), p + 2, RFIDREC_SIZE - 2);
+}
+
+static inline uint8_t RFIDRec_IsValid(const RFID_Record *rec)
+{
+    return RFIDREC_INFO_VERSION(rec->info) == RFIDREC_VERSION &&
+           (rec->info & 0x03) <= RFIDREC_UID_CODE_MAX &&
+           rec->crc == RFIDRec_Checksum(rec);
+}
+
+static inline uint8_t RFIDLog_HeaderChecksum(const RFIDLog_Header *hdr)
+{
+    return RFIDRec_Crc8(0, hdr, RFIDLOG_HEADER_SIZE - 1);
+}
+
+static inline uint8_t RFIDLog_DirChecksum(const RFIDLog_DirEntry *entry)
+{
+    const uint8_t *p = (const uint8_t *)entry;
+
+    return RFIDRec_Crc8(RFIDRec_Crc8(0, p, 1), p + 2, RFIDLOG_DIR_ENTRY_SIZE - 2);
+}
+
+static inline uint8_t RFIDLog_DirIsValid(const RFIDLog_DirEntry *entry)
+{
+    return RFIDREC_INFO_VERSION(entry->info) == RFIDREC_VERSION &&
+           (entry->info & 0x03) <= RFIDREC_UID_CODE_MAX &&
+           entry->crc == RFIDLog_DirChecksum(entry);
+}
+
+static inline uint8_t RFIDLog_DayChecksum(const RFIDLog_DayEntry *entry)
+{
+    const uint8_t *p = (const uint8_t *)entry;
+
+    return RFIDRec_Crc8(RFIDRec_Crc8(0, p, 2), p + 3, RFIDLOG_DAY_SIZE - 3);
+}
+
+static inline uint8_t RFIDLog_DayIsValid(const RFIDLog_DayEntry *entry)
+{
+    return entry->reserved == 0 && entry->crc == RFIDLog_DayChecksum(entry);
+}
+
+static inline uint8_t RFIDLog_SumChecksum(const RFIDLog_SumBlock *block)
+{
+    const uint8_t *p = (const uint8_t *)block;
+
+    return RFIDRec_Crc8(RFIDRec_Crc8(0, p, 1), p + 2, RFIDSUM_BLOCK_SIZE - 2);
+}
+
+/* An unused entry is RFIDSUM_VOID, any other needs a UID size code that fits */
+static inline uint8_t RFIDLog_SumIsValid(const RFIDLog_SumBlock *block)
+{
+    for (uint8_t i = 0; i < RFIDSUM_ENTRIES; i++)
+    {
+        if (block->entry[i].first != RFIDSUM_VOID &&
+            (block->entry[i].first >> 14) > RFIDREC_UID_CODE_MAX)
+        {
+            return 0;
+        }
+    }
+    return RFIDREC_INFO_VERSION(block->info) == RFIDSUM_VERSION &&
+           block->crc == RFIDLog_SumChecksum(block);
+}
+
+static inline uint8_t RFIDLog_MigrateChecksum(const RFIDLog_MigrateState *state)
+{
+    const uint8_t *p = (const uint8_t *)state;
+
+    return RFIDRec_Crc8(RFIDRec_Crc8(0, p, 1), p + 2, RFIDLOG_MIGRATE_SIZE - 2);
+}
+
+static inline uint8_t RFIDLog_MigrateIsValid(const RFIDLog_MigrateState *state)
+{
+    return (state->step == RFIDLOG_MIGRATE_SHIFT ||
+            state->step == RFIDLOG_MIGRATE_CONVERT) &&
+           state->crc == RFIDLog_MigrateChecksum(state);
+}
+
+/* Compact Events ------------------------------------------------------------*/
+static inline uint8_t RFIDCmp_EventCheck(uint32_t ev)
+{
+    uint8_t b[4];
+
+    ev &= 0x07FFFFFFUL;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        b[i] = (uint8_t)(ev >> (8 * i));
+    }
+    return RFIDRec_Crc8(0, b, 4) & 0x1F;
+}
+
+static inline uint32_t RFIDCmp_MakeEvent(uint8_t lap, uint8_t status,
+        uint16_t roster, uint16_t delta)
+{
+    uint32_t ev = ((uint32_t)(delta & RFIDCMP_DELTA_MAX) << 13) |
+                  ((uint32_t)(roster & 0x1FF) << 4) |
+                  ((uint32_t)(status & 0x03) << 2) | (lap & 0x03);
+
+    return ev | ((uint32_t)RFIDCmp_EventCheck(ev) << 27);
+}
+
+static inline uint8_t RFIDCmp_EventIsValid(uint32_t ev)
+{
+    return ev != 0xFFFFFFFFUL && (ev >> 27) == RFIDCmp_EventCheck(ev);
+}
+
+static inline uint8_t RFIDCmp_BaseChecksum(const RFID_CompactBase *base)
+{
+    const uint8_t *p = (const uint8_t *)base;
+
+    return RFIDRec_Crc8(RFIDRec_Crc8(0, p, 1), p + 2, RFIDCMP_BASE_SIZE - 2);
+}
+
+static inline uint8_t RFIDCmp_BaseIsValid(const RFID_CompactBase *base)
+{
+    return RFIDREC_INFO_VERSION(base->info) == RFIDCMP_VERSION &&
+           base->crc == RFIDCmp_BaseChecksum(base);
+}
+
+/* Region Layout -------------------------------------------------------------*/
+/* Page size of one AT24Cxx of deviceSize bytes: 32 up to the AT24C64, 64 up
+ * to the AT24C256, 128 for the AT24C512 */
+static inline uint16_t RFIDLog_PageSize(uint32_t deviceSize)
+{
+    return (deviceSize <= 0x2000UL) ? 32 : ((deviceSize <= 0x8000UL) ? 64 : 128);
+}
+
+/* Share of size / divisor in entries of entrySize, at most max, rounded
+ * down to whole pages */
+static inline uint16_t RFIDLog_Share(uint16_t size, uint16_t divisor,
+        uint16_t entrySize, uint16_t max, uint16_t pageSize)
+{
+    uint16_t n = size / divisor / entrySize;
+
+    n = (n > max) ? max : n;
+    return n - (n % (pageSize / entrySize));
+}
+
+/* Directory, summaries and ring below the day index */
+static inline void RFIDLog_PlaceRing(RFIDLog_Layout *l)
+{
+    l->dirAddr = l->dayAddr - (l->dirSlots * RFIDLOG_DIR_ENTRY_SIZE);
+    l->sumAddr = l->dirAddr - (l->sumBlocks * RFIDSUM_BLOCK_SIZE);
+    l->capacity = ((l->sumAddr - RFIDLOG_BASE_ADDR) / RFIDLOG_RING_BLOCK) *
+                  l->blockSlots;
+}
+
+/* Regions of a log on an EEPROM of size bytes in pages of pageSize bytes */
+static inline void RFIDLog_MakeLayout(RFIDLog_Layout *l, uint32_t size,
+        uint16_t pageSize, uint8_t compact)
+{
+    l->endAddr = (size < RFIDLOG_END_MAX) ? (uint16_t)size : RFIDLOG_END_MAX;
+    l->endAddr -= l->endAddr % pageSize;
+    l->rosterSize = compact ? RFIDLog_Share(l->endAddr, 4, RFIDREC_SIZE,
+                                            RFIDLOG_ROSTER_SIZE, pageSize) : 0;
+    l->rosterAddr = l->endAddr - (l->rosterSize * RFIDREC_SIZE);
+    l->daySlots = RFIDLog_Share(l->endAddr, 16, RFIDLOG_DAY_SIZE, RFIDLOG_DAYS,
+                                pageSize);
+    l->dayAddr = l->rosterAddr - (l->daySlots * RFIDLOG_DAY_SIZE);
+    l->sumBlocks = RFIDLog_Share(l->endAddr, 4, RFIDSUM_BLOCK_SIZE,
+                                 RFIDLOG_SUM_BLOCKS, pageSize);
+    l->blockSlots = compact ? RFIDCMP_EVENTS : (RFIDLOG_RING_BLOCK / RFIDREC_SIZE);
+    l->dirSlots = RFIDLog_Share(l->endAddr, 4, RFIDLOG_DIR_ENTRY_SIZE,
+                                RFIDLOG_DIR_SIZE, pageSize);
+    RFIDLog_PlaceRing(l);
+
+    /* The roster limits the UIDs of a compact log */
+    if ((compact ? l->rosterSize : l->capacity) <= RFIDLOG_DIR_MIN)
+    {
+        l->dirSlots = 0;
+        RFIDLog_PlaceRing(l);
+    }
+}
+
+/* Migration state of a legacy log of count records, see RFIDLog_MigrateState */
+static inline uint16_t RFIDLog_MigrateAddr(const RFIDLog_Layout *l,
+        uint16_t count)
+{
+    return (count > l->capacity) ? RFIDLOG_LEGACY_BASE_ADDR :
+           l->endAddr - (RFIDLOG_MIGRATE_COPIES * RFIDLOG_MIGRATE_SIZE);
+}
+
+/* Stamp Arithmetic ----------------------------------------------------------*/
+/* Seconds since 2000-01-01 00:00:00, every fourth year is a leap year up to
+ * 2063 (the last year a stamp can hold) */
+static inline uint32_t RFIDRec_StampToSeconds(uint32_t stamp)
+{
+    static const uint16_t before[12] = { 0, 31, 59, 90, 120, 151, 181, 212,
+                                         243, 273, 304, 334 };
+    uint32_t y = RFIDREC_YEAR(stamp);
+    uint32_t m = RFIDREC_MONTH(stamp);
+    uint32_t d = RFIDREC_DAY(stamp);
+    uint32_t days;
+
+    m = (m < 1) ? 1 : ((m > 12) ? 12 : m);
+    d = (d < 1) ? 1 : d;
+    days = (y * 365) + ((y + 3) / 4) + before[m - 1] + (d - 1) +
+           (((y % 4) == 0 && m > 2) ? 1 : 0);
+
+    return (((days * 24) + RFIDREC_HOUR(stamp)) * 60 + RFIDREC_MINUTE(stamp)) *
+           60 + RFIDREC_SECOND(stamp);
+}
+
+/* Days since 2000-01-01 */
+static inline uint16_t RFIDRec_StampToDate(uint32_t stamp)
+{
+    return (uint16_t)(RFIDRec_StampToSeconds(stamp) / 86400);
+}
+
+static inline uint32_t RFIDRec_SecondsToStamp(uint32_t sec)
+{
+    static const uint8_t length[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30,
+                                        31, 30, 31 };
+    uint32_t days = sec / 86400;
+    uint32_t rest = sec % 86400;
+    uint32_t y = 0;
+    uint32_t m = 0;
+
+    while (days >= ((y % 4) == 0 ? 366U : 365U))
+    {
+        days -= ((y % 4) == 0) ? 366 : 365;
+        y++;
+    }
+    while (days >= (uint32_t)length[m] + ((m == 1 && (y % 4) == 0) ? 1 : 0))
+    {
+        days -= length[m] + ((m == 1 && (y % 4) == 0) ? 1 : 0);
+        m++;
+    }
+
+    return RFIDREC_STAMP(y, m + 1, days + 1, rest / 3600, (rest / 60) % 60,
+                         rest % 60);
+}
+
+#ifdef __cplusplus
+ static_assert(sizeof(RFID_Record) == RFIDREC_SIZE, "RFID_Record must be 16 bytes");
+ static_assert(sizeof(RFIDLog_Header) == RFIDLOG_HEADER_SIZE, "RFIDLog_Header must be 16 bytes");
+ static_assert(sizeof(RFID_CompactBase) == RFIDCMP_BASE_SIZE, "RFID_CompactBase must be 8 bytes");
+ static_assert(sizeof(RFIDLog_DayEntry) == RFIDLOG_DAY_SIZE, "RFIDLog_DayEntry must be 8 bytes");
+ static_assert(sizeof(RFIDLog_DirEntry) == RFIDLOG_DIR_ENTRY_SIZE, "RFIDLog_DirEntry must be 16 bytes");
+ static_assert(sizeof(RFIDLog_SumEntry) == RFIDSUM_ENTRY_SIZE, "RFIDLog_SumEntry must be 14 bytes");
+ static_assert(sizeof(RFIDLog_SumBlock) == RFIDSUM_BLOCK_SIZE, "RFIDLog_SumBlock must be 32 bytes");
+ static_assert(sizeof(RFIDLog_MigrateState) == RFIDLOG_MIGRATE_SIZE, "RFIDLog_MigrateState must be 4 bytes");
+#else
+ _Static_assert(sizeof(RFID_Record) == RFIDREC_SIZE, "RFID_Record must be 16 bytes");
+ _Static_assert(sizeof(RFIDLog_Header) == RFIDLOG_HEADER_SIZE, "RFIDLog_Header must be 16 bytes");
+ _Static_assert(sizeof(RFID_CompactBase) == RFIDCMP_BASE_SIZE, "RFID_CompactBase must be 8 bytes");
+ _Static_assert(sizeof(RFIDLog_DayEntry) == RFIDLOG_DAY_SIZE, "RFIDLog_DayEntry must be 8 bytes");
+ _Static_assert(sizeof(RFIDLog_DirEntry) == RFIDLOG_DIR_ENTRY_SIZE, "RFIDLog_DirEntry must be 16 bytes");
+ _Static_assert(sizeof(RFIDLog_SumEntry) == RFIDSUM_ENTRY_SIZE, "RFIDLog_SumEntry must be 14 bytes");
+ _Static_assert(sizeof(RFIDLog_SumBlock) == RFIDSUM_BLOCK_SIZE, "RFIDLog_SumBlock must be 32 bytes");
+ _Static_assert(sizeof(RFIDLog_MigrateState) == RFIDLOG_MIGRATE_SIZE, "RFIDLog_MigrateState must be 4 bytes");
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* RFID_RECORD_H */
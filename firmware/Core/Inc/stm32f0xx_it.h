@@ -51,6 +51,10 @@ void HardFault_Handler(void);
 void SVC_Handler(void);
 void PendSV_Handler(void);
 void SysTick_Handler(void);
+void DMA1_Channel2_3_IRQHandler(void);
+void DMA1_Channel4_5_IRQHandler(void);
+void EXTI0_1_IRQHandler(void);
+void I2C2_IRQHandler(void);
 /* USER CODE BEGIN EFP */
 
 /* USER CODE END EFP */
@@ -0,0 +1,58 @@
+/**
+  ******************************************************************************
+  * @file    uid_index.h
+  * @brief   RAM-resident open-addressing index of the UIDs stored in the
+  *          EEPROM attendance log
+  ******************************************************************************
+  * @attention
+  * Usage:
+  *		Each slot holds an 8-bit hash tag and the log index of the record
+  *		that introduced the UID. A tag hit is confirmed by the caller through
+  *		the match callback (one record read), a miss never touches the bus.
+  *		When the table runs full the index stops being authoritative and
+  *		lookups report UID_INDEX_UNKNOWN so the caller can scan the EEPROM.
+  *		Evicted records are removed by leaving a tombstone; once too many
+  *		tombstones lengthen the probe chains the caller rebuilds the index.
+  *
+  ******************************************************************************
+  */
+#ifndef UID_INDEX_H
+#define UID_INDEX_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Index Geometry ------------------------------------------------------------*/
+#define UID_INDEX_SLOTS			512		// Must be a power of two (3 byte/slot)
+#define UID_INDEX_MAX_LOAD		((UID_INDEX_SLOTS * 3) / 4)
+#define UID_INDEX_EMPTY			0xFFFF
+#define UID_INDEX_DELETED		0xFFFE	// Tombstone left by UID_Index_Remove()
+
+typedef enum {
+    UID_INDEX_MISS = 0,		// UID is not in the log
+    UID_INDEX_HIT,			// UID found and confirmed by the match callback
+    UID_INDEX_UNKNOWN		// Index overflowed, caller has to scan the EEPROM
+} UID_Index_Result;
+
+/* Returns 1 when the log record at logIndex carries the given UID */
+typedef uint8_t (*UID_Index_MatchFn)(uint16_t logIndex, const uint8_t *uid,
+		uint8_t len);
+
+/* UID Index External Function -----------------------------------------------*/
+void UID_Index_Clear(void);
+uint8_t UID_Index_Insert(const uint8_t *uid, uint8_t len, uint16_t logIndex);
+uint8_t UID_Index_Remove(const uint8_t *uid, uint8_t len, uint16_t logIndex);
+UID_Index_Result UID_Index_Lookup(const uint8_t *uid, uint8_t len,
+		UID_Index_MatchFn match);
+uint16_t UID_Index_Count(void);
+uint16_t UID_Index_Deleted(void);
+uint8_t UID_Index_IsComplete(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* UID_INDEX_H */
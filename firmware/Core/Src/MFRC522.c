@@ -44,6 +44,46 @@
 #define CRCResultRegL  0x22 << 1
 #define VersionReg     0x37 << 1
 
+/* TxCRCEn and RxCRCEn, bit 7 of TxModeReg and RxModeReg */
+#define CRC_TX 0x01
+#define CRC_RX 0x02
+
+/* CRC_A (ISO14443-3): x^16 + x^12 + x^5 + 1 bit reversed, one entry per byte */
+static const uint16_t CrcATable[256] = {
+    0x0000, 0x1189, 0x2312, 0x329B, 0x4624, 0x57AD, 0x6536, 0x74BF,
+    0x8C48, 0x9DC1, 0xAF5A, 0xBED3, 0xCA6C, 0xDBE5, 0xE97E, 0xF8F7,
+    0x1081, 0x0108, 0x3393, 0x221A, 0x56A5, 0x472C, 0x75B7, 0x643E,
+    0x9CC9, 0x8D40, 0xBFDB, 0xAE52, 0xDAED, 0xCB64, 0xF9FF, 0xE876,
+    0x2102, 0x308B, 0x0210, 0x1399, 0x6726, 0x76AF, 0x4434, 0x55BD,
+    0xAD4A, 0xBCC3, 0x8E58, 0x9FD1, 0xEB6E, 0xFAE7, 0xC87C, 0xD9F5,
+    0x3183, 0x200A, 0x1291, 0x0318, 0x77A7, 0x662E, 0x54B5, 0x453C,
+    0xBDCB, 0xAC42, 0x9ED9, 0x8F50, 0xFBEF, 0xEA66, 0xD8FD, 0xC974,
+    0x4204, 0x538D, 0x6116, 0x709F, 0x0420, 0x15A9, 0x2732, 0x36BB,
+    0xCE4C, 0xDFC5, 0xED5E, 0xFCD7, 0x8868, 0x99E1, 0xAB7A, 0xBAF3,
+    0x5285, 0x430C, 0x7197, 0x601E, 0x14A1, 0x0528, 0x37B3, 0x263A,
+    0xDECD, 0xCF44, 0xFDDF, 0xEC56, 0x98E9, 0x8960, 0xBBFB, 0xAA72,
+    0x6306, 0x728F, 0x4014, 0x519D, 0x2522, 0x34AB, 0x0630, 0x17B9,
+    0xEF4E, 0xFEC7, 0xCC5C, 0xDDD5, 0xA96A, 0xB8E3, 0x8A78, 0x9BF1,
+    0x7387, 0x620E, 0x5095, 0x411C, 0x35A3, 0x242A, 0x16B1, 0x0738,
+    0xFFCF, 0xEE46, 0xDCDD, 0xCD54, 0xB9EB, 0xA862, 0x9AF9, 0x8B70,
+    0x8408, 0x9581, 0xA71A, 0xB693, 0xC22C, 0xD3A5, 0xE13E, 0xF0B7,
+    0x0840, 0x19C9, 0x2B52, 0x3ADB, 0x4E64, 0x5FED, 0x6D76, 0x7CFF,
+    0x9489, 0x8500, 0xB79B, 0xA612, 0xD2AD, 0xC324, 0xF1BF, 0xE036,
+    0x18C1, 0x0948, 0x3BD3, 0x2A5A, 0x5EE5, 0x4F6C, 0x7DF7, 0x6C7E,
+    0xA50A, 0xB483, 0x8618, 0x9791, 0xE32E, 0xF2A7, 0xC03C, 0xD1B5,
+    0x2942, 0x38CB, 0x0A50, 0x1BD9, 0x6F66, 0x7EEF, 0x4C74, 0x5DFD,
+    0xB58B, 0xA402, 0x9699, 0x8710, 0xF3AF, 0xE226, 0xD0BD, 0xC134,
+    0x39C3, 0x284A, 0x1AD1, 0x0B58, 0x7FE7, 0x6E6E, 0x5CF5, 0x4D7C,
+    0xC60C, 0xD785, 0xE51E, 0xF497, 0x8028, 0x91A1, 0xA33A, 0xB2B3,
+    0x4A44, 0x5BCD, 0x6956, 0x78DF, 0x0C60, 0x1DE9, 0x2F72, 0x3EFB,
+    0xD68D, 0xC704, 0xF59F, 0xE416, 0x90A9, 0x8120, 0xB3BB, 0xA232,
+    0x5AC5, 0x4B4C, 0x79D7, 0x685E, 0x1CE1, 0x0D68, 0x3FF3, 0x2E7A,
+    0xE70E, 0xF687, 0xC41C, 0xD595, 0xA12A, 0xB0A3, 0x8238, 0x93B1,
+    0x6B46, 0x7ACF, 0x4854, 0x59DD, 0x2D62, 0x3CEB, 0x0E70, 0x1FF9,
+    0xF78F, 0xE606, 0xD49D, 0xC514, 0xB1AB, 0xA022, 0x92B9, 0x8330,
+    0x7BC7, 0x6A4E, 0x58D5, 0x495C, 0x3DE3, 0x2C6A, 0x1EF1, 0x0F78
+};
+
 static void CS_LOW(MFRC522_HandleTypeDef *dev) {
     HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_RESET);
 }
@@ -52,21 +92,150 @@ static void CS_HIGH(MFRC522_HandleTypeDef *dev) {
     HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_SET);
 }
 
+/* One CS-low window, byte i of rx is clocked in while byte i of tx goes out */
+static HAL_StatusTypeDef TransferBlocking(MFRC522_HandleTypeDef *dev, uint8_t *tx, uint8_t *rx, uint16_t len) {
+    HAL_StatusTypeDef status;
+    CS_LOW(dev);
+    status = HAL_SPI_TransmitReceive(dev->hspi, tx, rx, len, MFRC522_SPI_TIMEOUT_MS);
+    CS_HIGH(dev);
+    return status;
+}
+
+/* Open a CS window on DMA, MFRC522_DmaCallback() closes it */
+static HAL_StatusTypeDef StartDma(MFRC522_HandleTypeDef *dev, uint8_t *tx, uint8_t *rx, uint16_t len) {
+    CS_LOW(dev);
+    if (HAL_SPI_TransmitReceive_DMA(dev->hspi, tx, rx, len) != HAL_OK) {
+        CS_HIGH(dev);
+        return HAL_ERROR;
+    }
+    return HAL_OK;
+}
+
+/* Sleep until the DMA transfer or script is done, interrupts (the EEPROM
+ * DMA, SysTick) are still served meanwhile */
+static HAL_StatusTypeDef WaitDma(MFRC522_HandleTypeDef *dev) {
+    uint32_t start = HAL_GetTick();
+    uint8_t state;
+
+    for (;;) {
+        __disable_irq();
+        if (dev->dma_state == MFRC522_DMA_BUSY) __WFI();
+        __enable_irq();
+        state = dev->dma_state;
+        if (state != MFRC522_DMA_BUSY) break;
+        if (HAL_GetTick() - start >= MFRC522_SPI_TIMEOUT_MS) {
+            dev->dma_next = NULL;
+            HAL_SPI_Abort(dev->hspi);
+            CS_HIGH(dev);
+            state = MFRC522_DMA_ERROR;
+            break;
+        }
+    }
+    dev->dma_state = MFRC522_DMA_IDLE;
+    return (state == MFRC522_DMA_DONE) ? HAL_OK : HAL_ERROR;
+}
+
+/* Called from HAL_SPI_TxRxCpltCallback() with ok set, from
+ * HAL_SPI_ErrorCallback() without */
+void MFRC522_DmaCallback(MFRC522_HandleTypeDef *dev, bool ok) {
+    uint8_t *w = dev->dma_next;
+
+    if (dev->dma_state != MFRC522_DMA_BUSY) return;
+    CS_HIGH(dev);
+    if (ok && w != NULL && w[0] != 0) {
+        // Next window of the script, started right here in the interrupt
+        dev->dma_next = w + w[0] + 1;
+        if (StartDma(dev, w + 1, w + 1, w[0]) == HAL_OK) return;
+        ok = false;
+    }
+    dev->dma_state = ok ? MFRC522_DMA_DONE : MFRC522_DMA_ERROR;
+}
+
+static HAL_StatusTypeDef Transfer(MFRC522_HandleTypeDef *dev, uint8_t *tx, uint8_t *rx, uint16_t len) {
+    if (!dev->use_dma || len < MFRC522_DMA_MIN_LEN) return TransferBlocking(dev, tx, rx, len);
+
+    dev->dma_next = NULL;
+    dev->dma_state = MFRC522_DMA_BUSY;
+    if (StartDma(dev, tx, rx, len) != HAL_OK) {
+        dev->dma_state = MFRC522_DMA_IDLE;
+        return HAL_ERROR;
+    }
+    return WaitDma(dev);
+}
+
 void MFRC522_WriteRegister(MFRC522_HandleTypeDef *dev, uint8_t reg, uint8_t val) {
     uint8_t data[2] = { reg & 0x7E, val };
     CS_LOW(dev);
-    HAL_SPI_Transmit(dev->hspi, data, 2, 10);
+    HAL_SPI_Transmit(dev->hspi, data, 2, MFRC522_SPI_TIMEOUT_MS);
     CS_HIGH(dev);
 }
 
 static uint8_t ReadReg(MFRC522_HandleTypeDef *dev, uint8_t reg) {
-    uint8_t tx = reg | 0x80;
-    uint8_t rx;
-    CS_LOW(dev);
-    HAL_SPI_Transmit(dev->hspi, &tx, 1, 10);
-    HAL_SPI_Receive(dev->hspi, &rx, 1, 10);
-    CS_HIGH(dev);
-    return rx;
+    uint8_t tx[2] = { reg | 0x80, 0x00 };
+    uint8_t rx[2];
+    Transfer(dev, tx, rx, 2);
+    return rx[1];
+}
+
+/* Register script: CS windows stored back to back as [length, bytes...], a
+ * zero length ends it. Each window is a register write or a burst into one
+ * register (FIFODataReg), the bytes read back overwrite the script. */
+static uint8_t *ScriptWrite(uint8_t *p, uint8_t reg, uint8_t val) {
+    *p++ = 2;
+    *p++ = reg & 0x7E;
+    *p++ = val;
+    return p;
+}
+
+static uint8_t *ScriptBurst(uint8_t *p, uint8_t reg, const uint8_t *data, uint8_t len) {
+    if (len > MFRC522_FIFO_SIZE) len = MFRC522_FIFO_SIZE;
+    *p++ = len + 1;
+    *p++ = reg & 0x7E;
+    memcpy(p, data, len);
+    return p + len;
+}
+
+/* On DMA the windows are chained from the completion interrupt, the caller
+ * only waits for the end of the whole script */
+static HAL_StatusTypeDef RunScript(MFRC522_HandleTypeDef *dev, uint8_t *script) {
+    HAL_StatusTypeDef status = HAL_OK;
+
+    if (dev->use_dma && script[0] != 0) {
+        dev->dma_next = script + script[0] + 1;
+        dev->dma_state = MFRC522_DMA_BUSY;
+        if (StartDma(dev, script + 1, script + 1, script[0]) != HAL_OK) {
+            dev->dma_state = MFRC522_DMA_IDLE;
+            return HAL_ERROR;
+        }
+        return WaitDma(dev);
+    }
+
+    for (; script[0] != 0 && status == HAL_OK; script += script[0] + 1) {
+        status = TransferBlocking(dev, script + 1, script + 1, script[0]);
+    }
+    return status;
+}
+
+/* Burst read: one address byte per value, 0x00 after the last one. The
+ * addresses may differ, so a status snapshot takes one window too. */
+static void ReadRegs(MFRC522_HandleTypeDef *dev, const uint8_t *regs, uint8_t *vals, uint8_t len) {
+    uint8_t tx[MFRC522_FIFO_SIZE + 1];
+    uint8_t rx[MFRC522_FIFO_SIZE + 1];
+    if (len > MFRC522_FIFO_SIZE) len = MFRC522_FIFO_SIZE;
+    for (uint8_t i = 0; i < len; i++) tx[i] = regs[i] | 0x80;
+    tx[len] = 0x00;
+    Transfer(dev, tx, rx, len + 1);
+    memcpy(vals, &rx[1], len);
+}
+
+static void ReadBurst(MFRC522_HandleTypeDef *dev, uint8_t reg, uint8_t *data, uint8_t len) {
+    uint8_t tx[MFRC522_FIFO_SIZE + 1];
+    uint8_t rx[MFRC522_FIFO_SIZE + 1];
+    if (len > MFRC522_FIFO_SIZE) len = MFRC522_FIFO_SIZE;
+    memset(tx, reg | 0x80, len);
+    tx[len] = 0x00;
+    Transfer(dev, tx, rx, len + 1);
+    memcpy(data, &rx[1], len);
 }
 
 static void AntennaOn(MFRC522_HandleTypeDef *dev) {
@@ -85,53 +254,112 @@ void MFRC522_Init(MFRC522_HandleTypeDef *dev) {
     HAL_GPIO_WritePin(dev->rst_port, dev->rst_pin, GPIO_PIN_SET); // Ensure HIGH
     HAL_Delay(50);
 
+    uint8_t script[9 * 3 + 1];
+    uint8_t *p = script;
+
+    dev->dma_state = MFRC522_DMA_IDLE;
     MFRC522_WriteRegister(dev, CommandReg, PCD_RESETPHASE);
+    dev->crc_regs = 0;
     HAL_Delay(50);
 
     // Timer settings for 25ms timeout
-    MFRC522_WriteRegister(dev, TModeReg, 0x80);
-    MFRC522_WriteRegister(dev, TPrescalerReg, 0xA9);
-    MFRC522_WriteRegister(dev, TReloadRegH, 0x03);
-    MFRC522_WriteRegister(dev, TReloadRegL, 0xE8);
+    p = ScriptWrite(p, TModeReg, 0x80);
+    p = ScriptWrite(p, TPrescalerReg, 0xA9);
+    p = ScriptWrite(p, TReloadRegH, 0x03);
+    p = ScriptWrite(p, TReloadRegL, 0xE8);
 
-    MFRC522_WriteRegister(dev, TxASKReg, 0x40);
-    MFRC522_WriteRegister(dev, ModeReg, 0x3D);
+    p = ScriptWrite(p, TxASKReg, 0x40);
+    p = ScriptWrite(p, ModeReg, 0x3D);
 
     // FORCE MAX GAIN
-    MFRC522_WriteRegister(dev, RFCfgReg, 0x07 << 4);
+    p = ScriptWrite(p, RFCfgReg, 0x07 << 4);
+
+    // IRQ pin push-pull and active low, no source enabled until a command waits
+    if (dev->irq_port != NULL) {
+        p = ScriptWrite(p, DivIEnReg, 0x80);
+        p = ScriptWrite(p, ComIEnReg, 0x80);
+        dev->irq_pending = 0;
+    }
+    *p = 0;
+    RunScript(dev, script);
 
     // Reset the internal phase of the antenna
     AntennaOn(dev);
 }
 
-static void MFRC522_CalculateCRC(MFRC522_HandleTypeDef *dev, uint8_t *pIndata, uint8_t len, uint8_t *pOutData) {
-    MFRC522_WriteRegister(dev, CommandReg, PCD_IDLE);
-    MFRC522_WriteRegister(dev, DivIrqReg, 0x04);
-    MFRC522_WriteRegister(dev, FIFOLevelReg, 0x80);
-
-    for (uint8_t i = 0; i < len; i++) {
-        MFRC522_WriteRegister(dev, FIFODataReg, pIndata[i]);
-    }
-    MFRC522_WriteRegister(dev, CommandReg, PCD_CALCCRC);
+/* Called from the EXTI callback of the IRQ pin */
+void MFRC522_IrqCallback(MFRC522_HandleTypeDef *dev) {
+    dev->irq_pending = 1;
+}
 
-    uint16_t i = 5000;
+/* Wait for one of the mask bits in ComIrqReg or DivIrqReg. With the IRQ pin
+ * wired the CPU sleeps until the pin fires, only the awaited sources drive
+ * it. Otherwise the register is polled. Returns the register, 0 on timeout. */
+static uint8_t WaitIrq(MFRC522_HandleTypeDef *dev, uint8_t reg, uint8_t mask, uint32_t timeout) {
+    uint32_t start = HAL_GetTick();
     uint8_t n;
+
     do {
-        n = ReadReg(dev, DivIrqReg);
-        i--;
-    } while ((i != 0) && !(n & 0x04));
+        if (dev->irq_port != NULL) {
+            // Any interrupt wakes the core, SysTick at least once per ms
+            __disable_irq();
+            if (!dev->irq_pending) __WFI();
+            __enable_irq();
+            if (!dev->irq_pending) continue;
+            dev->irq_pending = 0;
+        }
+        n = ReadReg(dev, reg);
+        if (n & mask) return n;
+    } while (HAL_GetTick() - start < timeout);
+
+    // A missed edge must not lose a finished command
+    n = ReadReg(dev, reg);
+    return (n & mask) ? n : 0;
+}
+
+uint16_t MFRC522_CrcA(const uint8_t *data, uint8_t len) {
+    uint16_t crc = 0x6363;
+    while (len--) crc = (crc >> 8) ^ CrcATable[(crc ^ *data++) & 0xFF];
+    return crc;
+}
+
+static void MFRC522_CalculateCRC(MFRC522_HandleTypeDef *dev, uint8_t *pIndata, uint8_t len, uint8_t *pOutData) {
+    uint8_t script[5 * 3 + MFRC522_FIFO_SIZE + 2 + 1];
+    uint8_t *p = script;
+
+    p = ScriptWrite(p, CommandReg, PCD_IDLE);
+    p = ScriptWrite(p, DivIrqReg, 0x04);
+    p = ScriptWrite(p, FIFOLevelReg, 0x80);
+    if (dev->irq_port != NULL) {
+        p = ScriptWrite(p, DivIEnReg, 0x80 | 0x04); // CRCIEn
+        dev->irq_pending = 0;
+    }
+
+    p = ScriptBurst(p, FIFODataReg, pIndata, len);
+    p = ScriptWrite(p, CommandReg, PCD_CALCCRC);
+    *p = 0;
+    RunScript(dev, script);
 
-    pOutData[0] = ReadReg(dev, CRCResultRegL);
-    pOutData[1] = ReadReg(dev, CRCResultRegM);
+    WaitIrq(dev, DivIrqReg, 0x04, MFRC522_CRC_TIMEOUT_MS);
+    if (dev->irq_port != NULL) {
+        MFRC522_WriteRegister(dev, DivIEnReg, 0x80); // Release the pin for the next wait
+    }
+
+    static const uint8_t result[2] = { CRCResultRegL, CRCResultRegM };
+    ReadRegs(dev, result, pOutData, 2);
 }
 
-MFRC522_Status MFRC522_ToCard(MFRC522_HandleTypeDef *dev, uint8_t cmd, uint8_t *sendData, uint8_t sendLen, uint8_t *backData, uint16_t *backLen) {
+/* crc: CRC_TX/CRC_RX for the frame, the mode registers are only written
+ * when that changes. At most backSize bytes of the reply are copied to
+ * backData, backLen still gives the bits the card sent. */
+MFRC522_Status MFRC522_ToCard(MFRC522_HandleTypeDef *dev, uint8_t cmd, uint8_t crc, uint8_t *sendData, uint8_t sendLen, uint8_t *backData, uint8_t backSize, uint16_t *backLen) {
     uint8_t status = MFRC522_ERR;
     uint8_t irqEn = 0x00;
     uint8_t waitIRq = 0x00;
     uint8_t lastBits;
     uint8_t n;
-    uint32_t i;
+    uint8_t script[7 * 3 + MFRC522_FIFO_SIZE + 2 + 1];
+    uint8_t *p = script;
 
     if (cmd == PCD_AUTHENT) {
         irqEn = 0x12;
@@ -141,50 +369,57 @@ MFRC522_Status MFRC522_ToCard(MFRC522_HandleTypeDef *dev, uint8_t cmd, uint8_t *
         waitIRq = 0x30;
     }
 
-    MFRC522_WriteRegister(dev, ComIEnReg, irqEn | 0x80);
-    MFRC522_WriteRegister(dev, ComIrqReg, 0x7F);        // Clear all IRQ bits
-    MFRC522_WriteRegister(dev, FIFOLevelReg, 0x80);     // Flush FIFO
-    MFRC522_WriteRegister(dev, CommandReg, PCD_IDLE);   // Stop any active command
+    if ((crc ^ dev->crc_regs) & CRC_TX) p = ScriptWrite(p, TxModeReg, (crc & CRC_TX) ? 0x80 : 0x00);
+    if ((crc ^ dev->crc_regs) & CRC_RX) p = ScriptWrite(p, RxModeReg, (crc & CRC_RX) ? 0x80 : 0x00);
+    dev->crc_regs = crc;
+
+    // Only the awaited sources and the timer drive the (inverted) IRQ pin
+    p = ScriptWrite(p, ComIEnReg, waitIRq | 0x01 | 0x80);
+    p = ScriptWrite(p, ComIrqReg, 0x7F);        // Clear all IRQ bits
+    p = ScriptWrite(p, FIFOLevelReg, 0x80);     // Flush FIFO
+    p = ScriptWrite(p, CommandReg, PCD_IDLE);   // Stop any active command
 
     // Writing data to FIFO
-    for (i = 0; i < sendLen; i++) {
-        MFRC522_WriteRegister(dev, FIFODataReg, sendData[i]);
-    }
+    p = ScriptBurst(p, FIFODataReg, sendData, sendLen);
 
     // Execute command
-    MFRC522_WriteRegister(dev, CommandReg, cmd);
+    p = ScriptWrite(p, CommandReg, cmd);
+    *p = 0;
+    dev->irq_pending = 0;
+    if (RunScript(dev, script) != HAL_OK) return MFRC522_ERR;
     if (cmd == PCD_TRANSCEIVE) {
         MFRC522_WriteRegister(dev, BitFramingReg, ReadReg(dev, BitFramingReg) | 0x80); // StartSend
     }
 
-    // Wait for completion
-    i = 2000; // Adjusted timeout loop
-    do {
-        n = ReadReg(dev, ComIrqReg);
-        i--;
-    } while ((i != 0) && !(n & 0x01) && !(n & waitIRq));
+    // Wait for completion or the chip timer
+    n = WaitIrq(dev, ComIrqReg, waitIRq | 0x01, MFRC522_CMD_TIMEOUT_MS);
 
     MFRC522_WriteRegister(dev, BitFramingReg, ReadReg(dev, BitFramingReg) & (~0x80)); // StopSend
+    if (dev->irq_port != NULL) {
+        MFRC522_WriteRegister(dev, ComIEnReg, 0x80); // Release the pin for the next wait
+    }
+
+    if (n != 0) {
+        // Error, FIFO level and valid bits of the last byte in one window
+        static const uint8_t state[3] = { ErrorReg, FIFOLevelReg, ControlReg };
+        uint8_t val[3];
+        ReadRegs(dev, state, val, 3);
 
-    if (i != 0) {
-        if (!(ReadReg(dev, ErrorReg) & 0x1B)) { // Check for Errors (BufferOvfl, Collerr, CRCErr, ProtErr)
+        if (!(val[0] & 0x1F)) { // Check for Errors (BufferOvfl, CollErr, CRCErr, ParityErr, ProtErr)
             status = MFRC522_OK;
             if (n & irqEn & 0x01) status = MFRC522_TIMEOUT;
 
             if (cmd == PCD_TRANSCEIVE) {
-                n = ReadReg(dev, FIFOLevelReg);
-                lastBits = ReadReg(dev, ControlReg) & 0x07;
+                n = val[1];
+                lastBits = val[2] & 0x07;
                 if (lastBits) *backLen = (n - 1) * 8 + lastBits;
                 else *backLen = n * 8;
 
                 if (n == 0) n = 1;
-                if (n > 16) n = 16;
+                if (n > backSize) n = backSize;
 
                 // Read the resulting data from FIFO
-                for (i = 0; i < n; i++) {
-                    backData[i] = ReadReg(dev, FIFODataReg);
-                }
-                backData[n] = 0; // Null terminate for safety
+                ReadBurst(dev, FIFODataReg, backData, n);
             }
         }
     }
@@ -195,14 +430,13 @@ bool MFRC522_IsNewCardPresent(MFRC522_HandleTypeDef *dev) {
     uint8_t buffer[2];
     uint16_t len;
 
-    MFRC522_WriteRegister(dev, TxModeReg, 0x00);
-    MFRC522_WriteRegister(dev, RxModeReg, 0x00);
     //MFRC522_WriteRegister(dev, ModWidthReg, 0x26);
 
     buffer[0] = PICC_REQIDL;
     MFRC522_WriteRegister(dev, BitFramingReg, 0x07);
 
-    MFRC522_Status status = MFRC522_ToCard(dev, PCD_TRANSCEIVE, buffer, 1, buffer, &len);
+    // No CRC on REQA, ToCard clears TxCRCEn/RxCRCEn if a frame left them set
+    MFRC522_Status status = MFRC522_ToCard(dev, PCD_TRANSCEIVE, 0, buffer, 1, buffer, sizeof(buffer), &len);
 
     if (status == MFRC522_OK) {
         // If we get here, the card finally talked back!
@@ -212,50 +446,79 @@ bool MFRC522_IsNewCardPresent(MFRC522_HandleTypeDef *dev) {
     return false;
 }
 
-bool MFRC522_SelectTag(MFRC522_HandleTypeDef *dev) {
+/* Send a frame that ends in a CRC_A. buf needs two spare bytes for it unless
+ * the chip appends it, rxCrc lets the chip also check and strip the reply's. */
+static MFRC522_Status TransceiveCrc(MFRC522_HandleTypeDef *dev, uint8_t *buf, uint8_t len, bool rxCrc, uint8_t *backData, uint8_t backSize, uint16_t *backLen) {
+    uint16_t crc;
+
+    if (dev->crc_mode == MFRC522_CRC_FRAME) {
+        return MFRC522_ToCard(dev, PCD_TRANSCEIVE, CRC_TX | (rxCrc ? CRC_RX : 0), buf, len, backData, backSize, backLen);
+    }
+    if (dev->crc_mode == MFRC522_CRC_CHIP) {
+        MFRC522_CalculateCRC(dev, buf, len, &buf[len]);
+    } else {
+        crc = MFRC522_CrcA(buf, len);
+        buf[len] = crc & 0xFF;
+        buf[len + 1] = crc >> 8;
+    }
+    return MFRC522_ToCard(dev, PCD_TRANSCEIVE, 0, buf, len + 2, backData, backSize, backLen);
+}
+
+/* SELECT one cascade level with its 4 UID bytes and BCC (cl[0..4]), the
+ * SAK it answers with goes to uid.sak */
+bool MFRC522_SelectTag(MFRC522_HandleTypeDef *dev, uint8_t sel, const uint8_t *cl) {
     uint8_t buffer[9];
     uint16_t len = 0;
 
-    buffer[0] = PICC_SELC;
+    buffer[0] = sel;
     buffer[1] = 0x70;
+    memcpy(&buffer[2], cl, 5);
 
-    buffer[2] = dev->uid.uidByte[0];
-    buffer[3] = dev->uid.uidByte[1];
-    buffer[4] = dev->uid.uidByte[2];
-    buffer[5] = dev->uid.uidByte[3];
-
-    buffer[6] = buffer[2] ^ buffer[3] ^ buffer[4] ^ buffer[5];
-
-    MFRC522_CalculateCRC(dev, buffer, 7, &buffer[7]);
-
-    MFRC522_Status status = MFRC522_ToCard(dev, PCD_TRANSCEIVE, buffer, 9, buffer, &len);
+    MFRC522_Status status = TransceiveCrc(dev, buffer, 7, true, buffer, sizeof(buffer), &len);
 
-    if (status == MFRC522_OK && len == 0x18) {
+    // SAK, plus its CRC_A unless the chip stripped it
+    if (status == MFRC522_OK && len == (dev->crc_mode == MFRC522_CRC_FRAME ? 0x08 : 0x18)) {
         dev->uid.sak = buffer[0];
         return true;
     }
     return false;
 }
 
+/* ISO14443-3 select sequence: up to three cascade levels of ANTICOLLISION
+ * and SELECT. While the SAK has its cascade bit set the level only carries
+ * the cascade tag and 3 UID bytes, so 4, 7 and 10 byte UIDs come out whole.
+ * A bit collision (two cards in the field) fails the read, the next poll
+ * tries again. */
 bool MFRC522_ReadCardSerial(MFRC522_HandleTypeDef *dev) {
-    uint8_t buffer[9];
+    static const uint8_t sel[3] = { PICC_ANTICOLL, PICC_ANTICOLL2, PICC_ANTICOLL3 };
+    uint8_t buffer[5];
     uint16_t len;
+    uint8_t size = 0;
 
-    MFRC522_WriteRegister(dev, BitFramingReg, 0x00);
-    buffer[0] = PICC_ANTICOLL;
-    buffer[1] = 0x20;
+    for (uint8_t level = 0; level < 3; level++) {
+        MFRC522_WriteRegister(dev, BitFramingReg, 0x00);
+        buffer[0] = sel[level];
+        buffer[1] = 0x20;
 
-    MFRC522_Status status = MFRC522_ToCard(dev, PCD_TRANSCEIVE, buffer, 2, buffer, &len);
+        MFRC522_Status status = MFRC522_ToCard(dev, PCD_TRANSCEIVE, 0, buffer, 2, buffer, sizeof(buffer), &len);
 
-    if (status == MFRC522_OK) {
-        for(int i=0; i<4; i++) dev->uid.uidByte[i] = buffer[i];
-        dev->uid.size = 4;
+        // 4 UID bytes and their BCC
+        if (status != MFRC522_OK || len != 0x28) return false;
+        if ((buffer[0] ^ buffer[1] ^ buffer[2] ^ buffer[3]) != buffer[4]) return false;
 
-        if (MFRC522_SelectTag(dev)) {
+        if (!MFRC522_SelectTag(dev, sel[level], buffer)) return false;
+
+        if (!(dev->uid.sak & 0x04)) {
+            // UID complete
+            memcpy(&dev->uid.uidByte[size], buffer, 4);
+            dev->uid.size = size + 4;
             return true;
         }
+        if (buffer[0] != PICC_CT) return false;
+        memcpy(&dev->uid.uidByte[size], &buffer[1], 3);
+        size += 3;
     }
-    return false;
+    return false; // Cascade bit still set after level 3
 }
 
 MFRC522_Status MFRC522_Authenticate(MFRC522_HandleTypeDef *dev, uint8_t blockAddr, MFRC522_Key *key, MFRC522_UID *uid) {
@@ -265,9 +528,10 @@ MFRC522_Status MFRC522_Authenticate(MFRC522_HandleTypeDef *dev, uint8_t blockAdd
     buff[0] = PICC_AUTH1A;
     buff[1] = blockAddr;
     memcpy(&buff[2], key->keyByte, 6);
-    memcpy(&buff[8], uid->uidByte, 4);
+    // The last 4 UID bytes, the cascade level 1 bytes of a 4 byte UID
+    memcpy(&buff[8], &uid->uidByte[uid->size - 4], 4);
 
-    MFRC522_ToCard(dev, PCD_AUTHENT, buff, 12, NULL, &len);
+    MFRC522_ToCard(dev, PCD_AUTHENT, 0, buff, 12, NULL, 0, &len);
 
     if ((ReadReg(dev, Status2Reg) & 0x08) == 0) {
         return MFRC522_ERR;
@@ -275,17 +539,18 @@ MFRC522_Status MFRC522_Authenticate(MFRC522_HandleTypeDef *dev, uint8_t blockAdd
     return MFRC522_OK;
 }
 
+// buffer holds 18 bytes, the block and its CRC_A
 MFRC522_Status MFRC522_ReadBlock(MFRC522_HandleTypeDef *dev, uint8_t blockAddr, uint8_t *buffer) {
     uint8_t buf[4];
     uint16_t len;
 
     buf[0] = PICC_READ;
     buf[1] = blockAddr;
-    MFRC522_CalculateCRC(dev, buf, 2, &buf[2]);
 
-    MFRC522_Status status = MFRC522_ToCard(dev, PCD_TRANSCEIVE, buf, 4, buffer, &len);
+    MFRC522_Status status = TransceiveCrc(dev, buf, 2, true, buffer, 18, &len);
 
-    if (status != MFRC522_OK || len != 0x90) {
+    // 16 data bytes, plus their CRC_A unless the chip checked and stripped it
+    if (status != MFRC522_OK || len != (dev->crc_mode == MFRC522_CRC_FRAME ? 0x80 : 0x90)) {
         return MFRC522_ERR;
     }
     return MFRC522_OK;
@@ -297,14 +562,13 @@ MFRC522_Status MFRC522_WriteBlock(MFRC522_HandleTypeDef *dev, uint8_t blockAddr,
 
     buf[0] = PICC_WRITE;
     buf[1] = blockAddr;
-    MFRC522_CalculateCRC(dev, buf, 2, &buf[2]);
 
-    if (MFRC522_ToCard(dev, PCD_TRANSCEIVE, buf, 4, buf, &len) != MFRC522_OK) return MFRC522_ERR;
+    // The 4 bit ACK has no CRC_A
+    if (TransceiveCrc(dev, buf, 2, false, buf, sizeof(buf), &len) != MFRC522_OK) return MFRC522_ERR;
 
     memcpy(buf, buffer, 16);
-    MFRC522_CalculateCRC(dev, buf, 16, &buf[16]);
 
-    if (MFRC522_ToCard(dev, PCD_TRANSCEIVE, buf, 18, buf, &len) != MFRC522_OK) return MFRC522_ERR;
+    if (TransceiveCrc(dev, buf, 16, false, buf, sizeof(buf), &len) != MFRC522_OK) return MFRC522_ERR;
 
     return MFRC522_OK;
 }
@@ -314,8 +578,7 @@ void MFRC522_Halt(MFRC522_HandleTypeDef *dev) {
     uint8_t buff[4];
     buff[0] = PICC_HALT;
     buff[1] = 0;
-    MFRC522_CalculateCRC(dev, buff, 2, &buff[2]);
-    MFRC522_ToCard(dev, PCD_TRANSCEIVE, buff, 4, buff, &unLen);
+    TransceiveCrc(dev, buff, 2, false, buff, sizeof(buff), &unLen);
 }
 
 void MFRC522_StopCrypto1(MFRC522_HandleTypeDef *dev) {
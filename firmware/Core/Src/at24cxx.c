@@ -1,321 +1,1149 @@
 /**
   ******************************************************************************
   * @file    at24cxx.c
-  * @brief   This file includes the HAL/LL driver for AT24C32/64 EEPROM
+  * @brief   This file includes the HAL/LL driver for AT24C32 to AT24C512 EEPROM
   ******************************************************************************
   */
 #include "AT24Cxx.h"
 
+#if AT24Cxx_DEV_NUM < 1 || AT24Cxx_DEV_NUM > 8
+#error "AT24Cxx_DEV_NUM must be 1 to 8"
+#endif
+
+static AT24Cxx_WriteStats WriteStats = { .MinUs = 0xFFFFFFFF };
+static uint32_t EepromSize = AT24Cxx_EEPROM_SIZE;	// Size of one device
+static uint16_t PageSize = AT24Cxx_PAGE_SIZE;
+
+static const uint16_t DevAddress[AT24Cxx_DEV_NUM] = AT24Cxx_DEV_ADDRESSES;
+static uint8_t DevBusy;							// Devices in their write cycle
+static uint32_t DevCycleStart[AT24Cxx_DEV_NUM];	// End of the last page write
+
+#ifdef LL_Driver
+static AT24Cxx_Backend BusBackend = AT24Cxx_BACKEND_LL;
+#else
+static AT24Cxx_Backend BusBackend = AT24Cxx_BACKEND_HAL;
+#endif
+
+/* Background erase: [EraseFloor, EraseTop) is left, erased from the top */
+static uint16_t EraseFloor;
+static uint32_t EraseTop;
+static uint8_t EraseInFlight;	// Page write queued, not completed yet
+static uint8_t EraseFailed;
+static uint8_t EraseBuf[AT24Cxx_PAGE_SIZE_MAX];
+
+typedef enum {
+	AT24Cxx_ASYNC_IDLE = 0,
+	AT24Cxx_ASYNC_XFER,			// DMA transfer in progress
+	AT24Cxx_ASYNC_DONE,			// Transfer finished, chunk not retired yet
+	AT24Cxx_ASYNC_FAILED		// Bus error reported by the HAL
+} AT24Cxx_AsyncState;
+
+typedef struct {
+	uint16_t MemAddr;
+	uint8_t *pData;
+	uint16_t Len;				// Bytes not transferred yet
+	uint8_t Read;
+	uint8_t Status;
+	uint8_t Cycles;				// Devices still programming pages of it
+	AT24Cxx_Callback Callback;
+	void *Context;
+} AT24Cxx_Request;
+
+static AT24Cxx_Request Queue[AT24Cxx_QUEUE_LEN];
+static uint8_t QueueHead;
+static uint8_t QueueCount;
+static uint8_t QueueSent;		// Requests at the head fully transferred
+static volatile AT24Cxx_AsyncState AsyncState;
+static uint16_t ChunkLen;
+static uint8_t ChunkDev;
+static uint32_t XferTick;
+static volatile uint32_t CycleStartUs;
+
 /**
-  * @brief  I2C Bus Write 16bit
+  * @brief  Microsecond time stamp built from the 1ms tick and SysTick
+  */
+static uint32_t AT24Cxx_Micros(void)
+{
+	uint32_t Ms, Val;
+
+	do
+	{
+		Ms = HAL_GetTick();
+		Val = SysTick->VAL;
+	} while (Ms != HAL_GetTick());
+
+	return (Ms * 1000U) + (((SysTick->LOAD - Val) * 1000U) /
+			(SysTick->LOAD + 1U));
+}
+
+/**
+  * @brief  Clear the flags and the transfer setup of the last LL transfer
+  */
+static void AT24Cxx_LL_Release(void)
+{
+	LL_I2C_ClearFlag_NACK(AT24Cxx_LL_I2C);
+	LL_I2C_ClearFlag_STOP(AT24Cxx_LL_I2C);
+
+	/* Clear Configuration Register 2 */
+	AT24Cxx_LL_I2C->CR2 &= (uint32_t)~((uint32_t)(I2C_CR2_SADD |
+			I2C_CR2_HEAD10R | I2C_CR2_NBYTES | I2C_CR2_RELOAD |
+			I2C_CR2_RD_WRN));
+}
+
+/**
+  * @brief  Give up an LL transfer: STOP if the bus is still held, then a
+  *			peripheral reset (PE low) clears the state machine and the flags
+  */
+static void AT24Cxx_LL_Abort(void)
+{
+	uint32_t Start = HAL_GetTick();
+
+	if (LL_I2C_IsActiveFlag_BUSY(AT24Cxx_LL_I2C) &&
+			!LL_I2C_IsActiveFlag_STOP(AT24Cxx_LL_I2C))
+	{
+		LL_I2C_GenerateStopCondition(AT24Cxx_LL_I2C);
+		while (!LL_I2C_IsActiveFlag_STOP(AT24Cxx_LL_I2C) &&
+				HAL_GetTick() - Start <= AT24Cxx_LL_TIMEOUT) {};
+	}
+
+	/* PE must stay low for three APB cycles, the read back covers them */
+	LL_I2C_Disable(AT24Cxx_LL_I2C);
+	(void)LL_I2C_IsEnabled(AT24Cxx_LL_I2C);
+	(void)LL_I2C_IsEnabled(AT24Cxx_LL_I2C);
+	LL_I2C_Enable(AT24Cxx_LL_I2C);
+
+	AT24Cxx_LL_Release();
+}
+
+/**
+  * @brief  Wait for a free bus before an LL transfer
+  * @retval Success = 0, Failed = 1 (bus held by another transfer)
+  */
+static uint8_t AT24Cxx_LL_Begin(void)
+{
+	uint32_t Start = HAL_GetTick();
+
+	/* Another master or a HAL DMA transfer may own the bus, leave it alone */
+	while (LL_I2C_IsActiveFlag_BUSY(AT24Cxx_LL_I2C))
+	{
+		if (HAL_GetTick() - Start > AT24Cxx_LL_TIMEOUT) return 1;
+	}
+
+	if (!LL_I2C_IsEnabled(AT24Cxx_LL_I2C))
+	{
+		LL_I2C_Enable(AT24Cxx_LL_I2C);
+	}
+	AT24Cxx_LL_Release();
+
+	return 0;
+}
+
+/**
+  * @brief  Wait for an ISR flag of the running LL transfer
+  * @retval Success = 0, Failed = 1 (NACK, bus error or timeout, aborted)
+  * @param  Flag	LL_I2C_ISR_xxx
+  */
+static uint8_t AT24Cxx_LL_Wait(uint32_t Flag)
+{
+	uint32_t Start = HAL_GetTick();
+
+	while ((AT24Cxx_LL_I2C->ISR & Flag) == 0U)
+	{
+		if ((AT24Cxx_LL_I2C->ISR & (LL_I2C_ISR_NACKF | LL_I2C_ISR_BERR |
+				LL_I2C_ISR_ARLO)) != 0U ||
+				HAL_GetTick() - Start > AT24Cxx_LL_TIMEOUT)
+		{
+			AT24Cxx_LL_Abort();
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+  * @brief  Finish an LL transfer after its last byte
   * @retval Success = 0, Failed = 1
-  * @param  DevAddr		Target device address
-  * @param  MemAddr  	Internal memory address
-  * @param  pData 		Pointer to data buffer
-  * @param  Len  		Amount of data to be Write
   */
-uint8_t AT24Cxx_Bus_Write(uint16_t DevAddr, uint16_t MemAddr, uint8_t *pData,
-		uint16_t Len)
+static uint8_t AT24Cxx_LL_End(void)
 {
-#ifdef LL_Driver
-	uint16_t XferCount = Len;
-	uint8_t *TxBuffer = pData;
-	uint16_t XferSize = 0;
-
-	/* Wait for I2C bus is free */
-	while (LL_I2C_IsActiveFlag_BUSY(I2Cx)) {};
-
-	if (!LL_I2C_IsEnabled(I2Cx))
-	{
-		LL_I2C_Enable(I2Cx);
-	}
-
-    /* Send Slave Address and Memory Address */
-    LL_I2C_HandleTransfer(I2Cx, DevAddr, LL_I2C_ADDRSLAVE_7BIT, 2,
-    		I2C_CR2_RELOAD, LL_I2C_GENERATE_START_WRITE);
-
-	 /* Send 16bit Memory Address */
-    while (!LL_I2C_IsActiveFlag_TXIS(I2Cx)){};
-    LL_I2C_TransmitData8(I2Cx, ((uint8_t)((uint16_t)(((uint16_t)(MemAddr
-    		& (uint16_t)(0xFF00U))) >> 8U))));	// MSB
-    while (!LL_I2C_IsActiveFlag_TXIS(I2Cx)){};
-    LL_I2C_TransmitData8(I2Cx, ((uint8_t)(uint16_t)(MemAddr
-    		& (uint16_t)0x00FF)));	// LSB
-
-	while (!LL_I2C_IsActiveFlag_TCR(I2Cx)) {};
-
-    /* Set NBYTES to write and reload if hi2c->XferCount > MAX_NBYTE_SIZE */
-    if (XferCount > 255U)
-    {
-        XferSize = 255U;
-        LL_I2C_HandleTransfer(I2Cx, DevAddr, LL_I2C_ADDRSLAVE_7BIT,
-        		(uint8_t)XferSize, I2C_CR2_RELOAD , LL_I2C_GENERATE_NOSTARTSTOP);
-    }
-    else
-    {
-        XferSize = XferCount;
-        LL_I2C_HandleTransfer(I2Cx, DevAddr, LL_I2C_ADDRSLAVE_7BIT,
-        		(uint8_t)XferSize, I2C_CR2_AUTOEND , LL_I2C_GENERATE_NOSTARTSTOP);
-    }
-
-    do
-    {
-        /* Wait until TXIS flag is set */
-    	while (!LL_I2C_IsActiveFlag_TXIS(I2Cx)) {};
-
-        /* Write data to TXDR */
-        LL_I2C_TransmitData8(I2Cx, *TxBuffer);
-
-        /* Increment Buffer pointer */
-        TxBuffer++;
-
-        XferCount--;
-        XferSize--;
-
-        if ((XferCount != 0U) && (XferSize == 0U))
-        {
-            /* Wait until TCR flag is set */
-        	while (!LL_I2C_IsActiveFlag_TCR(I2Cx)) {};
-
-            if (XferCount > 255U)
-            {
-                XferSize = 255U;
-                LL_I2C_HandleTransfer(I2Cx, DevAddr, LL_I2C_ADDRSLAVE_7BIT,
-                		(uint8_t)XferSize, I2C_CR2_RELOAD ,
-						LL_I2C_GENERATE_NOSTARTSTOP);
-            }
-            else
-            {
-                XferSize = XferCount;
-                LL_I2C_HandleTransfer(I2Cx, DevAddr, LL_I2C_ADDRSLAVE_7BIT,
-                		(uint8_t)XferSize, I2C_CR2_AUTOEND ,
-						LL_I2C_GENERATE_NOSTARTSTOP);
-            }
-        }
-    } while (XferCount > 0U);
-
-    /* No need to Check TC flag, with AUTOEND mode the stop is automatically
-     * generated
-     * Wait until STOPF flag is reset */
-    while (!LL_I2C_IsActiveFlag_STOP(I2Cx)) {};
-
-    /* Clear NACKF Flag */
-    LL_I2C_ClearFlag_NACK(I2Cx);
-
-    /* Clear STOP Flag */
-    LL_I2C_ClearFlag_STOP(I2Cx);
-
-    /* Clear Configuration Register 2 */
-    I2Cx->CR2 &= (uint32_t)~((uint32_t)(I2C_CR2_SADD | I2C_CR2_HEAD10R |
-    		I2C_CR2_NBYTES | I2C_CR2_RELOAD | I2C_CR2_RD_WRN));
-#else
-    // FIX: Changed AT24Cxx_PAGE_SIZE to 'Len'
-    if (HAL_I2C_Mem_Write(I2Cx, AT24Cxx_ADDRESS, MemAddr, I2C_MEMADD_SIZE_16BIT,
-            pData, Len, HAL_MAX_DELAY) != HAL_OK)
-    {
-        return 1;
-    }
-#endif
-    return 0;
+	uint8_t Nack;
+
+	/* AUTOEND generates the STOP after the last byte */
+	if (AT24Cxx_LL_Wait(LL_I2C_ISR_STOPF) != 0)
+	{
+		return 1;
+	}
+	Nack = LL_I2C_IsActiveFlag_NACK(AT24Cxx_LL_I2C);
+
+	AT24Cxx_LL_Release();
+
+	return Nack;
 }
 
 /**
-  * @brief  I2C Bus Read 16bits
+  * @brief  Program NBYTES for the next chunk of at most 255 bytes
+  * @retval Bytes in the chunk
+  */
+static uint8_t AT24Cxx_LL_Chunk(uint16_t DevAddr, uint32_t Left,
+		uint32_t Request)
+{
+	uint8_t Size = (Left > 255U) ? 255U : (uint8_t)Left;
+
+	LL_I2C_HandleTransfer(AT24Cxx_LL_I2C, DevAddr, LL_I2C_ADDRSLAVE_7BIT, Size,
+			(Left > 255U) ? LL_I2C_MODE_RELOAD : LL_I2C_MODE_AUTOEND, Request);
+
+	return Size;
+}
+
+/**
+  * @brief  LL write: memory address and data in one transfer
   * @retval Success = 0, Failed = 1
-  * @param  DevAddr		Target device address
-  * @param  MemAddr  	Internal memory address
-  * @param  pData 		Pointer to data buffer
-  * @param  Len  		Amount of data to be read
   */
-uint8_t AT24Cxx_Bus_Read(uint16_t DevAddr, uint16_t MemAddr, uint8_t *pData,
-		uint16_t Len)
+static uint8_t AT24Cxx_LL_Write(uint16_t DevAddr, uint16_t MemAddr,
+		uint8_t *pData, uint16_t Len)
 {
-#ifdef LL_Driver
-    uint16_t XferCount = Len;
-    uint16_t XferSize = 0;
-
-	/* Wait for I2C bus is free */
-	while (LL_I2C_IsActiveFlag_BUSY(I2Cx)) {};
-
-	if (!LL_I2C_IsEnabled(I2Cx))
-	{
-		LL_I2C_Enable(I2Cx);
-	}
-
-    /* Send Slave Address and Memory Address */
-    LL_I2C_HandleTransfer(I2Cx, DevAddr, LL_I2C_ADDRSLAVE_7BIT, 2,
-    		LL_I2C_MODE_SOFTEND, LL_I2C_GENERATE_START_WRITE);
-
-	 /* Send 16bit Memory Address */
-    while (!LL_I2C_IsActiveFlag_TXIS(I2Cx)) {};
-    LL_I2C_TransmitData8(I2Cx, ((uint8_t)((uint16_t)(((uint16_t)(MemAddr
-    		& (uint16_t)(0xFF00U))) >> 8U))));	// MSB
-    while (!LL_I2C_IsActiveFlag_TXIS(I2Cx)){};
-    LL_I2C_TransmitData8(I2Cx, ((uint8_t)(uint16_t)(MemAddr
-    		& (uint16_t)0x00FF)));	// LSB
-
-    while (!LL_I2C_IsActiveFlag_TC(I2Cx)) {};
-
-    /* Send Slave Address */
-    /* Set NBYTES to write and reload if hi2c->XferCount > MAX_NBYTE_SIZE */
-    if (XferCount > 255U)
-    {
-        XferSize = 255U;
-        LL_I2C_HandleTransfer(I2Cx, DevAddr, LL_I2C_ADDRSLAVE_7BIT,
-        		(uint8_t)XferSize, I2C_CR2_RELOAD, LL_I2C_GENERATE_START_READ);
-    }
-    else
-    {
-        XferSize = XferCount;
-        LL_I2C_HandleTransfer(I2Cx, DevAddr, LL_I2C_ADDRSLAVE_7BIT,
-        		(uint8_t)XferSize, I2C_CR2_AUTOEND, LL_I2C_GENERATE_START_READ);
-    }
-
-    do
-    {
-        /* Wait until RXNE flag is set */
-        while (!LL_I2C_IsActiveFlag_RXNE(I2Cx)) {};
-
-        /* Read data from RXDR */
-        *pData = LL_I2C_ReceiveData8(I2Cx);
-
-        /* Increment Buffer pointer */
-        pData++;
-        XferCount--;
-        XferSize--;
-
-        if ((XferCount != 0U) && (XferSize == 0U))
-        {
-            /* Wait until TCR flag is set */
-            while (!LL_I2C_IsActiveFlag_TCR(I2Cx)) {};
-
-            if (XferCount > 255U)
-            {
-                XferSize = 255U;
-
-                LL_I2C_HandleTransfer(I2Cx, DevAddr,
-                		LL_I2C_ADDRSLAVE_7BIT, (uint8_t)XferSize, I2C_CR2_RELOAD,
-						LL_I2C_GENERATE_NOSTARTSTOP);
-            }
-            else
-            {
-                XferSize = XferCount;
-                LL_I2C_HandleTransfer(I2Cx, DevAddr,
-                		LL_I2C_ADDRSLAVE_7BIT, (uint8_t)XferSize, I2C_CR2_AUTOEND,
-						LL_I2C_GENERATE_NOSTARTSTOP);
-            }
-        }
-    } while (XferCount > 0U);
-
-    /* No need to Check TC flag, with AUTOEND mode the stop is automatically
-     * generated.
-     * Wait until STOPF flag is reset */
-    while (!LL_I2C_IsActiveFlag_STOP(I2Cx)) {};
-
-	/* Clear NACKF Flag */
-    LL_I2C_ClearFlag_NACK(I2Cx);
-
-    /* Clear STOP Flag */
-    LL_I2C_ClearFlag_STOP(I2Cx);
-
-    /* Clear Configuration Register 2 */
-    I2Cx->CR2 &= (uint32_t)~((uint32_t)(I2C_CR2_SADD | I2C_CR2_HEAD10R |
-    		I2C_CR2_NBYTES | I2C_CR2_RELOAD | I2C_CR2_RD_WRN));
-#else
-	if (HAL_I2C_Mem_Read(I2Cx, AT24Cxx_ADDRESS, MemAddr, I2C_MEMADD_SIZE_16BIT,
-			pData, Len, HAL_MAX_DELAY) != 0)
+	uint32_t Left = (uint32_t)Len + 2U;		// 16 bit memory address first
+	uint8_t Addr[2] = { (uint8_t)(MemAddr >> 8), (uint8_t)MemAddr };
+	uint32_t Sent = 0;
+	uint8_t Size;
+
+	if (AT24Cxx_LL_Begin() != 0)
 	{
 		return 1;
 	}
-#endif
 
-    return 0;
+	Size = AT24Cxx_LL_Chunk(DevAddr, Left, LL_I2C_GENERATE_START_WRITE);
+	while (Left > 0U)
+	{
+		if (AT24Cxx_LL_Wait(LL_I2C_ISR_TXIS) != 0)
+		{
+			return 1;
+		}
+		LL_I2C_TransmitData8(AT24Cxx_LL_I2C,
+				(Sent < 2U) ? Addr[Sent] : pData[Sent - 2U]);
+		Sent++;
+		Left--;
+
+		if (--Size == 0U && Left > 0U)
+		{
+			if (AT24Cxx_LL_Wait(LL_I2C_ISR_TCR) != 0)
+			{
+				return 1;
+			}
+			Size = AT24Cxx_LL_Chunk(DevAddr, Left, LL_I2C_GENERATE_NOSTARTSTOP);
+		}
+	}
+
+	return AT24Cxx_LL_End();
 }
 
 /**
-  * @brief  Fill EEPROM page with selected value
+  * @brief  LL read: memory address write, repeated START, data read
   * @retval Success = 0, Failed = 1
-  * @param  Page	Any page up to AT24Cxx_PAGE_NUM
-  * @param  Value	Value to filled
   */
-uint8_t AT24Cxx_FillPage(uint16_t Page, uint8_t Value)
+static uint8_t AT24Cxx_LL_Read(uint16_t DevAddr, uint16_t MemAddr,
+		uint8_t *pData, uint16_t Len)
 {
-	uint8_t Buffer[AT24Cxx_PAGE_SIZE];
-	memset(Buffer, Value, AT24Cxx_PAGE_SIZE);
-	uint16_t MemAddr = Page << (int)(log(AT24Cxx_PAGE_SIZE) / log(2));
+	uint32_t Left = Len;
+	uint8_t Size;
 
-	AT24Cxx_Bus_Write(AT24Cxx_ADDRESS, MemAddr, Buffer, AT24Cxx_PAGE_SIZE);
+	if (AT24Cxx_LL_Begin() != 0)
+	{
+		return 1;
+	}
 
-#ifdef LL_Driver
-	LL_mDelay(5);	// 5ms Write cycle delay
-#else
-	HAL_Delay(5);	// 5ms Write cycle delay
-#endif
+	/* Send 16bit Memory Address, no STOP before the read */
+	LL_I2C_HandleTransfer(AT24Cxx_LL_I2C, DevAddr, LL_I2C_ADDRSLAVE_7BIT, 2,
+			LL_I2C_MODE_SOFTEND, LL_I2C_GENERATE_START_WRITE);
+	if (AT24Cxx_LL_Wait(LL_I2C_ISR_TXIS) != 0)
+	{
+		return 1;
+	}
+	LL_I2C_TransmitData8(AT24Cxx_LL_I2C, (uint8_t)(MemAddr >> 8));	// MSB
+	if (AT24Cxx_LL_Wait(LL_I2C_ISR_TXIS) != 0)
+	{
+		return 1;
+	}
+	LL_I2C_TransmitData8(AT24Cxx_LL_I2C, (uint8_t)MemAddr);			// LSB
+	if (AT24Cxx_LL_Wait(LL_I2C_ISR_TC) != 0)
+	{
+		return 1;
+	}
+
+	Size = AT24Cxx_LL_Chunk(DevAddr, Left, LL_I2C_GENERATE_START_READ);
+	while (Left > 0U)
+	{
+		if (AT24Cxx_LL_Wait(LL_I2C_ISR_RXNE) != 0)
+		{
+			return 1;
+		}
+		*pData++ = LL_I2C_ReceiveData8(AT24Cxx_LL_I2C);
+		Left--;
+
+		if (--Size == 0U && Left > 0U)
+		{
+			if (AT24Cxx_LL_Wait(LL_I2C_ISR_TCR) != 0)
+			{
+				return 1;
+			}
+			Size = AT24Cxx_LL_Chunk(DevAddr, Left, LL_I2C_GENERATE_NOSTARTSTOP);
+		}
+	}
+
+	return AT24Cxx_LL_End();
+}
+
+/**
+  * @brief  Select the backend of the blocking transfers
+  * @note   The asynchronous queue always runs on HAL DMA; switching drains it
+  * @param  Backend	AT24Cxx_BACKEND_HAL or AT24Cxx_BACKEND_LL
+  */
+void AT24Cxx_SetBackend(AT24Cxx_Backend Backend)
+{
+	AT24Cxx_Sync();
+	BusBackend = Backend;
+}
+
+AT24Cxx_Backend AT24Cxx_GetBackend(void)
+{
+	return BusBackend;
+}
+
+/**
+  * @brief  Address the device once and report whether it acknowledged
+  * @retval Ack = 0, Nack or bus error = 1
+  * @param  DevAddr		Target device address
+  */
+static uint8_t AT24Cxx_Probe(uint16_t DevAddr)
+{
+	uint8_t Nack;
+	uint32_t Start;
+
+	if (BusBackend != AT24Cxx_BACKEND_LL)
+	{
+		return (HAL_I2C_IsDeviceReady(AT24Cxx_I2C, DevAddr, 1, 1) == HAL_OK) ?
+				0 : 1;
+	}
+
+	if (AT24Cxx_LL_Begin() != 0)
+	{
+		return 1;
+	}
+
+	/* Address only, no data bytes: STOP follows the ACK or the NACK */
+	LL_I2C_HandleTransfer(AT24Cxx_LL_I2C, DevAddr, LL_I2C_ADDRSLAVE_7BIT, 0,
+			LL_I2C_MODE_AUTOEND, LL_I2C_GENERATE_START_WRITE);
+
+	Start = HAL_GetTick();
+	while (!LL_I2C_IsActiveFlag_STOP(AT24Cxx_LL_I2C))
+	{
+		if (HAL_GetTick() - Start > AT24Cxx_LL_TIMEOUT)
+		{
+			AT24Cxx_LL_Abort();
+			return 1;
+		}
+	}
+	Nack = LL_I2C_IsActiveFlag_NACK(AT24Cxx_LL_I2C);
+
+	AT24Cxx_LL_Release();
+
+	return Nack;
+}
+
+/**
+  * @brief  Account one measured write cycle
+  */
+static void AT24Cxx_RecordCycle(uint32_t Elapsed)
+{
+	WriteStats.LastUs = Elapsed;
+	WriteStats.TotalUs += Elapsed;
+	WriteStats.Count++;
+	if (Elapsed < WriteStats.MinUs) WriteStats.MinUs = Elapsed;
+	if (Elapsed > WriteStats.MaxUs) WriteStats.MaxUs = Elapsed;
+}
+
+/**
+  * @brief  ACK polling, wait until the internal write cycle has finished
+  * @retval Success = 0, Failed = 1 (no ACK within AT24Cxx_WRITE_TIMEOUT)
+  * @param  DevAddr		Target device address
+  */
+uint8_t AT24Cxx_WaitReady(uint16_t DevAddr)
+{
+	uint32_t Start = AT24Cxx_Micros();
+
+	/* The device does not acknowledge its address during the write cycle */
+	while (AT24Cxx_Probe(DevAddr) != 0)
+	{
+		if (AT24Cxx_Micros() - Start > (AT24Cxx_WRITE_TIMEOUT * 1000U))
+		{
+			WriteStats.Timeouts++;
+			return 1;
+		}
+	}
+
+	AT24Cxx_RecordCycle(AT24Cxx_Micros() - Start);
 
 	return 0;
 }
 
 /**
-  * @brief  Erase EEPROM with value 0xFF
-  * @retval Success = 0, Failed = 1
+  * @brief  Map a memory address to a device, pages go round robin over the
+  *			AT24Cxx_DEV_ADDRESSES
+  * @retval Bytes from MemAddr up to the end of its page
+  * @param  MemAddr		Memory address as seen by the caller
+  * @param  Dev			Index of the device holding it
+  * @param  PhysAddr	Address inside that device
   */
-uint8_t AT24Cxx_EraseChip(void)
+static uint16_t AT24Cxx_Map(uint16_t MemAddr, uint8_t *Dev, uint16_t *PhysAddr)
+{
+	uint16_t Page = MemAddr / PageSize;
+	uint16_t Offset = MemAddr % PageSize;
+
+	*Dev = Page % AT24Cxx_DEV_NUM;
+	*PhysAddr = ((Page / AT24Cxx_DEV_NUM) * PageSize) + Offset;
+
+	return PageSize - Offset;
+}
+
+/**
+  * @brief  Wait for the write cycle of one device, if it has one running
+  * @retval Success = 0, Failed = 1 (no ACK within AT24Cxx_WRITE_TIMEOUT)
+  * @param  Dev		Index into AT24Cxx_DEV_ADDRESSES
+  */
+static uint8_t AT24Cxx_WaitDevice(uint8_t Dev)
 {
-	for (uint16_t i = 0; i < AT24Cxx_PAGE_NUM; i++)
+	uint32_t Start = DevCycleStart[Dev];
+
+	if (!(DevBusy & (1U << Dev)))
+	{
+		return 0;
+	}
+	DevBusy &= ~(1U << Dev);
+
+	while (AT24Cxx_Probe(DevAddress[Dev]) != 0)
 	{
-		if (AT24Cxx_FillPage(i, 0xFF) != 0)
+		if (AT24Cxx_Micros() - Start > (AT24Cxx_WRITE_TIMEOUT * 1000U))
 		{
+			WriteStats.Timeouts++;
 			return 1;
 		}
 	}
 
+	AT24Cxx_RecordCycle(AT24Cxx_Micros() - Start);
+
 	return 0;
 }
 
+static uint8_t AT24Cxx_WaitAll(void)
+{
+	uint8_t Status = 0;
+
+	for (uint8_t Dev = 0; Dev < AT24Cxx_DEV_NUM; Dev++)
+	{
+		Status |= AT24Cxx_WaitDevice(Dev);
+	}
+	return Status;
+}
+
 /**
-  * @brief  Sequential read from selected memory address with number of byte
+  * @brief  Measured write cycle times of the page writes so far
+  */
+const AT24Cxx_WriteStats *AT24Cxx_GetWriteStats(void)
+{
+	return &WriteStats;
+}
+
+/**
+  * @brief  I2C Bus Write 16bit
   * @retval Success = 0, Failed = 1
-  * @param  MemAddr	Memory address to start read from
-  * @param  pData	Pointer to data
-  * @param  Len		Number of byte to read
+  * @param  DevAddr		Target device address
+  * @param  MemAddr  	Internal memory address
+  * @param  pData 		Pointer to data buffer
+  * @param  Len  		Amount of data to be Write
   */
-uint8_t AT24Cxx_ReadByte(uint16_t MemAddr, uint8_t *pData, uint16_t Len)
+uint8_t AT24Cxx_Bus_Write(uint16_t DevAddr, uint16_t MemAddr, uint8_t *pData,
+		uint16_t Len)
 {
-	AT24Cxx_Bus_Read(AT24Cxx_ADDRESS, MemAddr, pData, Len);
+	if (BusBackend == AT24Cxx_BACKEND_LL)
+	{
+		return AT24Cxx_LL_Write(DevAddr, MemAddr, pData, Len);
+	}
 
+	if (HAL_I2C_Mem_Write(AT24Cxx_I2C, DevAddr, MemAddr, I2C_MEMADD_SIZE_16BIT,
+			pData, Len, AT24Cxx_XFER_TIMEOUT) != HAL_OK)
+	{
+		return 1;
+	}
 	return 0;
 }
 
 /**
-  * @brief  Write data into EEPROM
+  * @brief  I2C Bus Read 16bits
   * @retval Success = 0, Failed = 1
-  * @param  MemAddr	Memory address to start write from
-  * @param  pData	Pointer to data
-  * @param  Len		Number of byte to write
+  * @param  DevAddr		Target device address
+  * @param  MemAddr  	Internal memory address
+  * @param  pData 		Pointer to data buffer
+  * @param  Len  		Amount of data to be read
   */
-uint8_t AT24Cxx_WriteByte(uint16_t MemAddr, uint8_t *value, uint16_t Len)
+uint8_t AT24Cxx_Bus_Read(uint16_t DevAddr, uint16_t MemAddr, uint8_t *pData,
+		uint16_t Len)
 {
-	while (Len > AT24Cxx_PAGE_SIZE)
+	if (BusBackend == AT24Cxx_BACKEND_LL)
 	{
-		uint16_t WrtSize = AT24Cxx_PAGE_SIZE - (MemAddr % AT24Cxx_PAGE_SIZE);
-
-		AT24Cxx_Bus_Write(AT24Cxx_ADDRESS, MemAddr, value, WrtSize);
-		value += WrtSize;
-		Len -= WrtSize;
-		MemAddr += WrtSize;
-#ifdef LL_Driver
-		LL_mDelay(5);	// 5ms Write cycle delay
-#else
-		HAL_Delay(5);	// 5ms Write cycle delay
-#endif
+		return AT24Cxx_LL_Read(DevAddr, MemAddr, pData, Len);
 	}
-	/* Write the remaining data */
-	AT24Cxx_Bus_Write(AT24Cxx_ADDRESS, MemAddr, value, Len);
-#ifdef LL_Driver
-	LL_mDelay(5);	// 5ms Write cycle delay
-#else
-	HAL_Delay(5);	// 5ms Write cycle delay
-#endif
 
+	if (HAL_I2C_Mem_Read(AT24Cxx_I2C, DevAddr, MemAddr, I2C_MEMADD_SIZE_16BIT,
+			pData, Len, AT24Cxx_XFER_TIMEOUT) != HAL_OK)
+	{
+		return 1;
+	}
 	return 0;
 }
+
+/**
+  * @brief  Start a page write on one device, after its previous write cycle
+  * @retval Success = 0, Failed = 1
+  */
+static uint8_t AT24Cxx_StartPage(uint8_t Dev, uint16_t PhysAddr, uint8_t *pData,
+		uint16_t Len)
+{
+	if (AT24Cxx_WaitDevice(Dev) != 0 ||
+			AT24Cxx_Bus_Write(DevAddress[Dev], PhysAddr, pData, Len) != 0)
+	{
+		return 1;
+	}
+
+	/* The other devices keep programming, only this one is waited for */
+	DevCycleStart[Dev] = AT24Cxx_Micros();
+	DevBusy |= (1U << Dev);
+
+	return 0;
+}
+
+/**
+  * @brief  Blocking page writes, consecutive pages overlap on striped devices
+  * @retval Success = 0, Failed = 1
+  * @param  Fill	1 = pData holds one page written everywhere
+  */
+static uint8_t AT24Cxx_WritePages(uint16_t MemAddr, uint8_t *pData,
+		uint32_t Len, uint8_t Fill)
+{
+	uint8_t Dev;
+	uint16_t PhysAddr;
+	uint8_t Status = 0;
+
+	AT24Cxx_Sync();
+	/* Split at page boundaries, a page write rolls over within its page */
+	while (Len > 0 && Status == 0)
+	{
+		uint16_t WrtSize = AT24Cxx_Map(MemAddr, &Dev, &PhysAddr);
+		if (WrtSize > Len)
+		{
+			WrtSize = Len;
+		}
+
+		Status = AT24Cxx_StartPage(Dev, PhysAddr, pData, WrtSize);
+		if (!Fill)
+		{
+			pData += WrtSize;
+		}
+		Len -= WrtSize;
+		MemAddr += WrtSize;
+	}
+
+	return Status | AT24Cxx_WaitAll();
+}
+
+/**
+  * @brief  Fill a range of the EEPROM with selected value, page by page
+  * @retval Success = 0, Failed = 1
+  * @param  MemAddr	Memory address to start fill from
+  * @param  Value	Value to filled
+  * @param  Len		Number of byte to fill
+  */
+uint8_t AT24Cxx_Fill(uint16_t MemAddr, uint8_t Value, uint32_t Len)
+{
+	uint8_t Buffer[AT24Cxx_PAGE_SIZE_MAX];
+	memset(Buffer, Value, PageSize);
+
+	return AT24Cxx_WritePages(MemAddr, Buffer, Len, 1);
+}
+
+/**
+  * @brief  Fill EEPROM page with selected value
+  * @retval Success = 0, Failed = 1
+  * @param  Page	Any page below AT24Cxx_Size() / AT24Cxx_PageSize()
+  * @param  Value	Value to filled
+  */
+uint8_t AT24Cxx_FillPage(uint16_t Page, uint8_t Value)
+{
+	return AT24Cxx_Fill((uint16_t)((uint32_t)Page * PageSize), Value, PageSize);
+}
+
+/**
+  * @brief  Erase every device with value 0xFF
+  * @retval Success = 0, Failed = 1
+  * @note   Blocks for every page, AT24Cxx_EraseStart(0, AT24Cxx_Size())
+  *			does the same in the background
+  */
+uint8_t AT24Cxx_EraseChip(void)
+{
+	uint8_t Buffer[AT24Cxx_PAGE_SIZE_MAX];
+	uint8_t Status = 0;
+
+	AT24Cxx_Sync();
+	memset(Buffer, 0xFF, PageSize);
+
+	/* Each device in turn, its write cycle overlaps the next page write */
+	for (uint32_t PhysAddr = 0; PhysAddr < EepromSize && Status == 0;
+			PhysAddr += PageSize)
+	{
+		for (uint8_t Dev = 0; Dev < AT24Cxx_DEV_NUM && Status == 0; Dev++)
+		{
+			Status = AT24Cxx_StartPage(Dev, PhysAddr, Buffer, PageSize);
+		}
+	}
+
+	return Status | AT24Cxx_WaitAll();
+}
+
+/**
+  * @brief  Start erasing a range with 0xFF in the background, one page per
+  *			AT24Cxx_EraseStep()
+  * @retval Started = 0, Failed = 1 (another erase is still running)
+  * @param  MemAddr	Memory address to start erase from
+  * @param  Len		Number of byte to erase
+  * @note   Pages go from the end of the range down, AT24Cxx_EraseLimit()
+  *			can give the lower part back while the job runs.
+  */
+uint8_t AT24Cxx_EraseStart(uint16_t MemAddr, uint32_t Len)
+{
+	if (EraseInFlight || EraseTop > EraseFloor)
+	{
+		return 1;
+	}
+
+	memset(EraseBuf, 0xFF, sizeof(EraseBuf));
+	EraseFloor = MemAddr;
+	EraseTop = (uint32_t)MemAddr + Len;
+	EraseFailed = 0;
+
+	return 0;
+}
+
+/**
+  * @brief  Leave the bytes below MemAddr alone, e.g. because new data lives
+  *			there now. Pages already queued are written anyway.
+  */
+void AT24Cxx_EraseLimit(uint16_t MemAddr)
+{
+	if (MemAddr > EraseFloor)
+	{
+		EraseFloor = MemAddr;
+	}
+}
+
+static void AT24Cxx_ErasePageDone(uint8_t Status, void *Context)
+{
+	EraseFailed |= Status;
+	EraseInFlight = 0;
+}
+
+/**
+  * @brief  Erase the next page of the background erase job
+  * @retval Finished or no job = 0, Running = 1, Failed = 2 (job stopped)
+  * @note   The page write is queued and completes from AT24Cxx_Poll(),
+  *			a step never waits for a write cycle.
+  */
+uint8_t AT24Cxx_EraseStep(void)
+{
+	if (EraseFailed)
+	{
+		EraseTop = EraseFloor;
+		return 2;
+	}
+	if (EraseInFlight)
+	{
+		return 1;
+	}
+	if (EraseTop <= EraseFloor)
+	{
+		return 0;
+	}
+
+	/* The top page of what is left, clipped to the range */
+	uint32_t Start = (EraseTop - 1) - ((EraseTop - 1) % PageSize);
+	if (Start < EraseFloor)
+	{
+		Start = EraseFloor;
+	}
+
+	if (AT24Cxx_WriteAsync((uint16_t)Start, EraseBuf,
+			(uint16_t)(EraseTop - Start), AT24Cxx_ErasePageDone, NULL) != 0)
+	{
+		return 1;			// Queue full, retried on the next step
+	}
+	EraseInFlight = 1;
+	EraseTop = Start;
+
+	return 1;
+}
+
+/**
+  * @brief  Bytes the background erase job has not started on yet
+  */
+uint32_t AT24Cxx_EraseLeft(void)
+{
+	return (EraseTop > EraseFloor) ? EraseTop - EraseFloor : 0;
+}
+
+/**
+  * @brief  Sequential read from selected memory address with number of byte
+  * @retval Success = 0, Failed = 1
+  * @param  MemAddr	Memory address to start read from
+  * @param  pData	Pointer to data
+  * @param  Len		Number of byte to read
+  */
+uint8_t AT24Cxx_ReadByte(uint16_t MemAddr, uint8_t *pData, uint16_t Len)
+{
+	uint8_t Dev;
+	uint16_t PhysAddr;
+	uint8_t Status = 0;
+
+	AT24Cxx_Sync();
+	/* A single device reads across pages, striped ones page by page */
+	while (Len > 0)
+	{
+		uint16_t RdSize = AT24Cxx_Map(MemAddr, &Dev, &PhysAddr);
+		if (RdSize > Len || AT24Cxx_DEV_NUM == 1)
+		{
+			RdSize = Len;
+		}
+
+		Status |= AT24Cxx_Bus_Read(DevAddress[Dev], PhysAddr, pData, RdSize);
+		pData += RdSize;
+		Len -= RdSize;
+		MemAddr += RdSize;
+	}
+
+	return Status;
+}
+
+/**
+  * @brief  Write data into EEPROM
+  * @retval Success = 0, Failed = 1
+  * @param  MemAddr	Memory address to start write from
+  * @param  pData	Pointer to data
+  * @param  Len		Number of byte to write
+  */
+uint8_t AT24Cxx_WriteByte(uint16_t MemAddr, uint8_t *value, uint16_t Len)
+{
+	return AT24Cxx_WritePages(MemAddr, value, Len, 0);
+}
+
+/**
+  * @brief  Set the EEPROM geometry, the page size follows from the density
+  *			(32 byte up to AT24C64, 64 byte up to AT24C256, 128 byte AT24C512)
+  * @param  Size	Size of one device in byte, a power of two from 4096 to
+  *					65536. Striped devices must all be of the same type.
+  */
+void AT24Cxx_SetSize(uint32_t Size)
+{
+	if (Size < AT24Cxx_EEPROM_SIZE || Size > AT24Cxx_EEPROM_SIZE_MAX ||
+			(Size & (Size - 1)) != 0)
+	{
+		return;
+	}
+
+	EepromSize = Size;
+	if (Size <= 0x2000)
+	{
+		PageSize = AT24Cxx_PAGE_SIZE;
+	}
+	else if (Size <= 0x8000)
+	{
+		PageSize = 2 * AT24Cxx_PAGE_SIZE;
+	}
+	else
+	{
+		PageSize = AT24Cxx_PAGE_SIZE_MAX;
+	}
+}
+
+/**
+  * @brief  Size of one device
+  */
+uint32_t AT24Cxx_DeviceSize(void)
+{
+	return EepromSize;
+}
+
+/**
+  * @brief  Size of the address space over all striped devices
+  */
+uint32_t AT24Cxx_Size(void)
+{
+	return EepromSize * AT24Cxx_DEV_NUM;
+}
+
+uint16_t AT24Cxx_PageSize(void)
+{
+	return PageSize;
+}
+
+/**
+  * @brief  Probe the size of the attached EEPROM by address aliasing
+  * @retval Success = 0, Failed = 1 (a device is missing, geometry unchanged)
+  * @param  ScratchAddr	Byte below 4096 the probe may toggle, it is restored.
+  *						It lies in page 0, which is on the first device.
+  * @note   A device ignores the address bits above its size, so reading
+  *			ScratchAddr + Size returns the byte at ScratchAddr. Equal contents
+  *			alone prove nothing (erased areas), a match is confirmed by
+  *			toggling the scratch byte and reading the alias again.
+  */
+uint8_t AT24Cxx_Detect(uint16_t ScratchAddr)
+{
+	uint8_t Orig, Alias, Test;
+	uint8_t Status;
+	uint32_t Size;
+
+	AT24Cxx_Sync();
+	for (uint8_t Dev = 0; Dev < AT24Cxx_DEV_NUM; Dev++)
+	{
+		if (AT24Cxx_Probe(DevAddress[Dev]) != 0)
+		{
+			return 1;
+		}
+	}
+
+	ScratchAddr %= AT24Cxx_EEPROM_SIZE;
+	if (AT24Cxx_Bus_Read(DevAddress[0], ScratchAddr, &Orig, 1) != 0)
+	{
+		return 1;
+	}
+
+	for (Size = AT24Cxx_EEPROM_SIZE; Size < AT24Cxx_EEPROM_SIZE_MAX; Size <<= 1)
+	{
+		if (AT24Cxx_Bus_Read(DevAddress[0], ScratchAddr + Size, &Alias, 1) != 0)
+		{
+			return 1;
+		}
+		if (Alias != Orig)
+		{
+			continue;
+		}
+
+		Test = Orig ^ 0xA5;
+		if (AT24Cxx_StartPage(0, ScratchAddr, &Test, 1) != 0 ||
+				AT24Cxx_WaitDevice(0) != 0)
+		{
+			return 1;
+		}
+		Status = AT24Cxx_Bus_Read(DevAddress[0], ScratchAddr + Size, &Alias, 1);
+		if (AT24Cxx_StartPage(0, ScratchAddr, &Orig, 1) != 0 ||
+				AT24Cxx_WaitDevice(0) != 0 || Status != 0)
+		{
+			return 1;
+		}
+		if (Alias == Test)
+		{
+			break;
+		}
+	}
+
+	AT24Cxx_SetSize(Size);
+	return 0;
+}
+
+/**
+  * @brief  Start the DMA transfer for the next chunk of the first request
+  *			not fully transferred, unless its device is still programming
+  */
+static void AT24Cxx_StartChunk(void)
+{
+	AT24Cxx_Request *Req = &Queue[(QueueHead + QueueSent) % AT24Cxx_QUEUE_LEN];
+	HAL_StatusTypeDef Status;
+	uint16_t PhysAddr;
+
+	/* One page per write, a page write rolls over within its page. Reads
+	 * only split where the next page lives on another device. */
+	ChunkLen = AT24Cxx_Map(Req->MemAddr, &ChunkDev, &PhysAddr);
+	if (ChunkLen > Req->Len || (Req->Read && AT24Cxx_DEV_NUM == 1))
+	{
+		ChunkLen = Req->Len;
+	}
+
+	/* The device ignores its address during the write cycle, AT24Cxx_Poll()
+	 * retries once it acknowledges again */
+	if (DevBusy & (1U << ChunkDev))
+	{
+		return;
+	}
+
+	XferTick = HAL_GetTick();
+	AsyncState = AT24Cxx_ASYNC_XFER;
+
+	if (Req->Read)
+	{
+		Status = HAL_I2C_Mem_Read_DMA(AT24Cxx_I2C, DevAddress[ChunkDev], PhysAddr,
+				I2C_MEMADD_SIZE_16BIT, Req->pData, ChunkLen);
+	}
+	else
+	{
+		Status = HAL_I2C_Mem_Write_DMA(AT24Cxx_I2C, DevAddress[ChunkDev], PhysAddr,
+				I2C_MEMADD_SIZE_16BIT, Req->pData, ChunkLen);
+	}
+
+	if (Status != HAL_OK)
+	{
+		AsyncState = AT24Cxx_ASYNC_FAILED;
+	}
+}
+
+/**
+  * @brief  Account the finished transfer of the current chunk
+  * @param  Failed	1 = bus error, the rest of the request is dropped
+  */
+static void AT24Cxx_ChunkDone(uint8_t Failed)
+{
+	AT24Cxx_Request *Req = &Queue[(QueueHead + QueueSent) % AT24Cxx_QUEUE_LEN];
+
+	if (Failed)
+	{
+		Req->Status = 1;
+		Req->Len = 0;
+	}
+	else
+	{
+		if (!Req->Read)
+		{
+			DevCycleStart[ChunkDev] = CycleStartUs;
+			DevBusy |= (1U << ChunkDev);
+			Req->Cycles |= (1U << ChunkDev);
+		}
+		Req->MemAddr += ChunkLen;
+		Req->pData += ChunkLen;
+		Req->Len -= ChunkLen;
+	}
+
+	if (Req->Len == 0)
+	{
+		QueueSent++;
+	}
+	AsyncState = AT24Cxx_ASYNC_IDLE;
+}
+
+/**
+  * @brief  Give up a DMA transfer that never completed: stop both channels
+  *			and reset I2C2, the HAL handle would stay busy otherwise
+  * @note   MspInit links and initialises the DMA channels again
+  */
+static void AT24Cxx_AbortXfer(void)
+{
+	I2C_HandleTypeDef *hi2c = AT24Cxx_I2C;
+
+	if (hi2c->hdmatx != NULL)
+	{
+		HAL_DMA_Abort(hi2c->hdmatx);
+	}
+	if (hi2c->hdmarx != NULL)
+	{
+		HAL_DMA_Abort(hi2c->hdmarx);
+	}
+
+	/* Same configuration as MX_I2C2_Init(), the filters are reset values */
+	HAL_I2C_DeInit(hi2c);
+	HAL_I2C_Init(hi2c);
+}
+
+/**
+  * @brief  A device finished its write cycle (or never acknowledged again)
+  */
+static void AT24Cxx_CycleDone(uint8_t Dev, uint8_t Failed)
+{
+	DevBusy &= ~(1U << Dev);
+
+	for (uint8_t i = 0; i < QueueCount; i++)
+	{
+		AT24Cxx_Request *Req = &Queue[(QueueHead + i) % AT24Cxx_QUEUE_LEN];
+		if (Req->Cycles & (1U << Dev))
+		{
+			Req->Cycles &= ~(1U << Dev);
+			Req->Status |= Failed;
+		}
+	}
+}
+
+/**
+  * @brief  Retire the queue head and run its callback
+  */
+static void AT24Cxx_Complete(void)
+{
+	AT24Cxx_Request Req = Queue[QueueHead];
+
+	QueueHead = (QueueHead + 1) % AT24Cxx_QUEUE_LEN;
+	QueueCount--;
+	QueueSent--;
+
+	if (Req.Callback)
+	{
+		Req.Callback(Req.Status, Req.Context);
+	}
+}
+
+static uint8_t AT24Cxx_Submit(uint16_t MemAddr, uint8_t *pData, uint16_t Len,
+		uint8_t Read, AT24Cxx_Callback Callback, void *Context)
+{
+	if (QueueCount >= AT24Cxx_QUEUE_LEN || Len == 0)
+	{
+		return 1;
+	}
+
+	AT24Cxx_Request *Req = &Queue[(QueueHead + QueueCount) % AT24Cxx_QUEUE_LEN];
+	Req->MemAddr = MemAddr;
+	Req->pData = pData;
+	Req->Len = Len;
+	Req->Read = Read;
+	Req->Status = 0;
+	Req->Cycles = 0;
+	Req->Callback = Callback;
+	Req->Context = Context;
+	QueueCount++;
+
+	if (AsyncState == AT24Cxx_ASYNC_IDLE && QueueSent < QueueCount)
+	{
+		AT24Cxx_StartChunk();
+	}
+	return 0;
+}
+
+/**
+  * @brief  Queue a write, split into page writes on DMA. With striped
+  *			devices the next page goes out while the previous device is
+  *			still in its write cycle.
+  * @retval Queued = 0, Queue full = 1
+  * @param  MemAddr		Memory address to start write from
+  * @param  pData		Data, must stay valid until the callback has run
+  * @param  Len			Number of byte to write
+  * @param  Callback	Called from AT24Cxx_Poll() once the last write cycle
+  *						has finished, may be NULL
+  */
+uint8_t AT24Cxx_WriteAsync(uint16_t MemAddr, uint8_t *pData, uint16_t Len,
+		AT24Cxx_Callback Callback, void *Context)
+{
+	return AT24Cxx_Submit(MemAddr, pData, Len, 0, Callback, Context);
+}
+
+/**
+  * @brief  Queue a sequential read on DMA
+  * @retval Queued = 0, Queue full = 1
+  */
+uint8_t AT24Cxx_ReadAsync(uint16_t MemAddr, uint8_t *pData, uint16_t Len,
+		AT24Cxx_Callback Callback, void *Context)
+{
+	return AT24Cxx_Submit(MemAddr, pData, Len, 1, Callback, Context);
+}
+
+/**
+  * @brief  Advance the request queue, never blocks longer than one probe
+  *			per device in its write cycle
+  */
+void AT24Cxx_Poll(void)
+{
+	/* The bus is free between transfers: ask the programming devices */
+	if (AsyncState != AT24Cxx_ASYNC_XFER)
+	{
+		for (uint8_t Dev = 0; Dev < AT24Cxx_DEV_NUM; Dev++)
+		{
+			if (!(DevBusy & (1U << Dev)))
+			{
+				continue;
+			}
+			if (AT24Cxx_Probe(DevAddress[Dev]) == 0)
+			{
+				AT24Cxx_RecordCycle(AT24Cxx_Micros() - DevCycleStart[Dev]);
+				AT24Cxx_CycleDone(Dev, 0);
+			}
+			else if (AT24Cxx_Micros() - DevCycleStart[Dev] >
+					(AT24Cxx_WRITE_TIMEOUT * 1000U))
+			{
+				WriteStats.Timeouts++;
+				AT24Cxx_CycleDone(Dev, 1);
+			}
+		}
+	}
+
+	switch (AsyncState)
+	{
+	case AT24Cxx_ASYNC_IDLE:
+		break;
+
+	case AT24Cxx_ASYNC_XFER:
+		if (HAL_GetTick() - XferTick > AT24Cxx_XFER_TIMEOUT)
+		{
+			AT24Cxx_AbortXfer();
+			AT24Cxx_ChunkDone(1);
+		}
+		break;
+
+	case AT24Cxx_ASYNC_DONE:
+		AT24Cxx_ChunkDone(0);
+		break;
+
+	case AT24Cxx_ASYNC_FAILED:
+		AT24Cxx_ChunkDone(1);
+		break;
+	}
+
+	/* Requests complete in order, once their last write cycle is over */
+	while (QueueSent && Queue[QueueHead].Cycles == 0)
+	{
+		AT24Cxx_Complete();
+	}
+	if (AsyncState == AT24Cxx_ASYNC_IDLE && QueueSent < QueueCount)
+	{
+		AT24Cxx_StartChunk();
+	}
+}
+
+uint8_t AT24Cxx_IsIdle(void)
+{
+	return (QueueCount == 0);
+}
+
+/**
+  * @brief  Block until every queued request has completed
+  */
+void AT24Cxx_Sync(void)
+{
+	while (QueueCount)
+	{
+		AT24Cxx_Poll();
+	}
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	if (hi2c == AT24Cxx_I2C && AsyncState == AT24Cxx_ASYNC_XFER)
+	{
+		CycleStartUs = AT24Cxx_Micros();
+		AsyncState = AT24Cxx_ASYNC_DONE;
+	}
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	if (hi2c == AT24Cxx_I2C && AsyncState == AT24Cxx_ASYNC_XFER)
+	{
+		AsyncState = AT24Cxx_ASYNC_DONE;
+	}
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+	if (hi2c == AT24Cxx_I2C && AsyncState == AT24Cxx_ASYNC_XFER)
+	{
+		AsyncState = AT24Cxx_ASYNC_FAILED;
+	}
+}
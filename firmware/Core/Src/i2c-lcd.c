@@ -18,6 +18,7 @@ void lcd_send_cmd (char cmd)
     data_t[2] = data_l|0x0C;  // en=1, rs=0 -> bxxxx1100
     data_t[3] = data_l|0x08;  // en=0, rs=0 -> bxxxx1000
 
+    I2C2_WaitIdle();  // The EEPROM driver may be using the bus via DMA
     HAL_I2C_Master_Transmit (&hi2c2, SLAVE_ADDRESS_LCD,(uint8_t *) data_t, 4, 100);
 }
 
@@ -33,6 +34,7 @@ void lcd_send_data (char data)
     data_t[2] = data_l|0x0D;  // en=1, rs=1 -> bxxxx1101
     data_t[3] = data_l|0x09;  // en=0, rs=1 -> bxxxx1001
 
+    I2C2_WaitIdle();
     HAL_I2C_Master_Transmit (&hi2c2, SLAVE_ADDRESS_LCD,(uint8_t *) data_t, 4, 100);
 }
 
@@ -3,13 +3,19 @@
 #include "mfrc522.h"
 #include "at24cxx.h"
 #include "i2c-lcd.h"
+#include "uid_index.h"
+#include "rfid_log.h"
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
 
 /* --- Hardware Handles --- */
 I2C_HandleTypeDef hi2c2;
+DMA_HandleTypeDef hdma_i2c2_rx;
+DMA_HandleTypeDef hdma_i2c2_tx;
 SPI_HandleTypeDef hspi1;
+DMA_HandleTypeDef hdma_spi1_rx;
+DMA_HandleTypeDef hdma_spi1_tx;
 UART_HandleTypeDef huart1;
 MFRC522_HandleTypeDef rfid;
 MFRC522_Key key;
@@ -19,23 +25,19 @@ MFRC522_Key key;
 #define BTN_PREV_PIN GPIO_PIN_1
 #define BTN_NEXT_PIN GPIO_PIN_2
 #define BTN_PORT GPIOA
-
-typedef struct __attribute__((packed)) {
-    uint8_t year;
-    uint8_t month;
-    uint8_t day;
-    uint8_t hour;
-    uint8_t minute;
-    uint8_t second;
-    uint8_t uid[5];
-    uint8_t status;
-} RFID_Log;
-
-#define LOG_SIZE sizeof(RFID_Log)
+#define RFID_IRQ_PORT GPIOB
+#define RFID_IRQ_PIN GPIO_PIN_1
+#define LOG_IDLE_FLUSH_MS 1000 // Flush staged records once the field is quiet
+//#define LOG_SCAN_BENCHMARK     // Time a full log scan at boot
+//#define I2C_BACKEND_BENCHMARK  // Time EEPROM transfers on HAL and LL at boot
+//#define RFID_CRC_BENCHMARK     // Time block reads with each CRC_A source on the first card
+//#define RFID_IRQ_WIRED         // MFRC522 IRQ on PB1 (EXTI1), else its IRQ registers are polled
+#define RFID_SPI_DMA             // MFRC522 FIFO bursts and register scripts on DMA, else blocking SPI
 
 /* --- Function Prototypes --- */
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
 static void MX_I2C2_Init(void);
 static void MX_SPI1_Init(void);
 static void MX_USART1_UART_Init(void);
@@ -54,12 +56,15 @@ void DS3231_SetTime(void) {
     buf[4] = dec2bcd(13); // Day
     buf[5] = dec2bcd(1);  // Month
     buf[6] = dec2bcd(26); // Year (2026)
+    I2C2_WaitIdle();
     HAL_I2C_Mem_Write(&hi2c2, DS3231_I2C_ADDR, 0x00, 1, buf, 7, 100);
 }
 
-void DS3231_GetDateTime(RTC_TimeTypeDef *t, RTC_DateTypeDef *d) {
+// Returns 0 with the time read, 1 if the bus or the clock failed
+uint8_t DS3231_GetDateTime(RTC_TimeTypeDef *t, RTC_DateTypeDef *d) {
    uint8_t buf[7];
-   HAL_I2C_Mem_Read(&hi2c2, DS3231_I2C_ADDR, 0x00, 1, buf, 7, 100);
+   I2C2_WaitIdle();
+   if (HAL_I2C_Mem_Read(&hi2c2, DS3231_I2C_ADDR, 0x00, 1, buf, 7, 100) != HAL_OK) return 1;
    t->Seconds = bcd2dec(buf[0] & 0x7F);
    t->Minutes = bcd2dec(buf[1]);
    t->Hours   = bcd2dec(buf[2] & 0x3F);
@@ -67,6 +72,10 @@ void DS3231_GetDateTime(RTC_TimeTypeDef *t, RTC_DateTypeDef *d) {
    d->Date    = bcd2dec(buf[4]);
    d->Month   = bcd2dec(buf[5] & 0x1F);
    d->Year    = bcd2dec(buf[6]);
+   // A glitched read can ACK and still return junk, never stamp a tap with it
+   if (t->Seconds > 59 || t->Minutes > 59 || t->Hours > 23 ||
+       d->Date < 1 || d->Date > 31 || d->Month < 1 || d->Month > 12) return 1;
+   return 0;
 }
 
 /* --- Serial Helper Functions --- */
@@ -97,66 +106,295 @@ void PrintMsg(char *str) {
 
 /* --- Logic Helper Functions --- */
 
+// Confirm an index tag hit against the record stored in EEPROM
+static uint8_t Log_Entry_Matches(uint16_t slot, const uint8_t *uid, uint8_t len) {
+    RFID_Record rec;
+    if (RFIDLog_ReadAt(slot, &rec) != 0) return 0;
+    return RFIDREC_INFO_UID_SIZE(rec.info) == len && memcmp(rec.uid, uid, len) == 0;
+}
+
+// Rebuild the RAM UID index from the EEPROM log (once at boot)
+static void Rebuild_UID_Index(void) {
+    RFIDLog_Iter it;
+    RFID_Record rec;
+    uint8_t res;
+
+    UID_Index_Clear();
+    RFIDLog_Begin(&it);
+    while ((res = RFIDLog_Next(&it, &rec)) != RFIDLOG_ITER_END) {
+        if (res != 0) continue; // CRC mismatch or filler, skip record
+        UID_Index_Insert(rec.uid, RFIDREC_INFO_UID_SIZE(rec.info), it.slot);
+    }
+
+    char buf[48];
+    sprintf(buf, "UID index: %u entries%s\r\n", UID_Index_Count(),
+            UID_Index_IsComplete() ? "" : " (overflow)");
+    PrintMsg(buf);
+}
+
 // Check if UID exists in EEPROM
-uint8_t Is_Card_Already_Logged(uint8_t* uid) {
-    uint16_t logCount = 0;
-    RFID_Log tempLog;
+uint8_t Is_Card_Already_Logged(uint8_t* uid, uint8_t len) {
+    UID_Index_Result res = UID_Index_Lookup(uid, len, Log_Entry_Matches);
+    if (res != UID_INDEX_UNKNOWN) {
+        return res == UID_INDEX_HIT;
+    }
 
-    AT24Cxx_ReadByte(0x0000, (uint8_t*)&logCount, 2);
-    if (logCount == 0xFFFF) return 0;
+    // RAM index overflowed: binary search in the sorted EEPROM directory
+    uint16_t slot;
+    uint8_t dir = RFIDLog_FindUID(uid, len, &slot);
+    if (dir != 2) {
+        return dir == 0;
+    }
+
+    // Directory full, behind or absent as well: only a full scan is conclusive
+    PrintMsg("UID directory incomplete, scanning EEPROM\r\n");
 
-    for (uint16_t i = 0; i < logCount; i++) {
-        uint16_t readAddr = 2 + (i * LOG_SIZE);
-        AT24Cxx_ReadByte(readAddr, (uint8_t*)&tempLog, LOG_SIZE);
+    RFIDLog_Iter it;
+    RFID_Record rec;
+    uint8_t bad;
 
-        // Compare UIDs (assuming 4 or 5 byte UIDs)
-        if (memcmp(tempLog.uid, uid, 5) == 0) {
+    RFIDLog_Begin(&it);
+    while ((bad = RFIDLog_Next(&it, &rec)) != RFIDLOG_ITER_END) {
+        if (!bad && RFIDREC_INFO_UID_SIZE(rec.info) == len &&
+                memcmp(rec.uid, uid, len) == 0) {
             return 1; // Found duplicate
         }
     }
     return 0; // Not found
 }
 
-void Log_RFID_Event(uint8_t* uid, uint8_t status) {
-    RFID_Log newLog;
-    uint16_t logCount = 0;
+// Records leave the log when overwritten or rolled up, drop them from the index
+static void Log_Entry_Evicted(uint16_t slot, const RFID_Record *rec) {
+    UID_Index_Remove(rec->uid, RFIDREC_INFO_UID_SIZE(rec->info), slot);
+}
+
+// Returns 0 once the event is staged, 1 if the log had no room for it,
+// 2 if the clock could not be read
+uint8_t Log_RFID_Event(uint8_t* uid, uint8_t len, uint8_t status) {
+    RFID_Record rec;
     RTC_TimeTypeDef sTime;
     RTC_DateTypeDef sDate;
 
     // 1. Get Time
-    DS3231_GetDateTime(&sTime, &sDate);
+    if (DS3231_GetDateTime(&sTime, &sDate) != 0) {
+        PrintMsg("RTC read failed, event not saved\r\n");
+        return 2;
+    }
 
     // 2. Prepare Log
-    newLog.year   = sDate.Year;
-    newLog.month  = sDate.Month;
-    newLog.day    = sDate.Date;
-    newLog.hour   = sTime.Hours;
-    newLog.minute = sTime.Minutes;
-    newLog.second = sTime.Seconds;
-    newLog.status = status;
-    memcpy(newLog.uid, uid, 5);
-
-    // 3. Read Current Count
-    AT24Cxx_ReadByte(0x0000, (uint8_t*)&logCount, 2);
-    if (logCount == 0xFFFF) logCount = 0;
-
-    // 4. Calculate Address
-    uint16_t writeAddr = 2 + (logCount * sizeof(RFID_Log));
-
-    // Circular Buffer Logic
-    if (writeAddr + sizeof(RFID_Log) >= 32768) { // Max size for AT24C256
-        logCount = 0;
-        writeAddr = 2;
+    RFIDLog_MakeRecord(&rec, uid, len, status,
+            RFIDREC_STAMP(sDate.Year, sDate.Month, sDate.Date,
+                          sTime.Hours, sTime.Minutes, sTime.Seconds));
+
+    // 3. Stage the record, whole pages are written back as they fill up
+    uint16_t slot = RFIDLog_Append(&rec);
+    if (slot == RFIDLOG_NO_SLOT) {
+        PrintMsg("Log roster full, event not saved\r\n");
+        return 1;
+    }
+
+    // Too many tombstones make probing slow, start over from the log
+    if (UID_Index_Deleted() > UID_INDEX_SLOTS / 4) Rebuild_UID_Index();
+    else UID_Index_Insert(uid, len, slot);
+    return 0;
+}
+
+// Report the measured EEPROM write cycle times (ACK polling)
+void Print_EEPROM_Stats(void) {
+    const AT24Cxx_WriteStats *st = AT24Cxx_GetWriteStats();
+    char buf[64];
+    if (st->Count == 0) return;
+    sprintf(buf, "EEPROM tWR: last %lu us, min %lu, max %lu, avg %lu\r\n",
+            st->LastUs, st->MinUs, st->MaxUs, st->TotalUs / st->Count);
+    PrintMsg(buf);
+}
+
+// Report the probed EEPROM geometry and the resulting log capacity
+void Print_EEPROM_Geometry(void) {
+    char buf[64];
+    sprintf(buf, "EEPROM: %u x %lu bytes, %u byte pages, %u log slots, %u summaries\r\n",
+            AT24Cxx_DEV_NUM, AT24Cxx_DeviceSize(), AT24Cxx_PageSize(),
+            RFIDLog_Capacity(), RFIDLog_SummaryCapacity());
+    PrintMsg(buf);
+}
+
+// Export the taps of one day over UART, the day index limits the scan
+void Print_Day_Log(uint32_t stamp) {
+    RFIDLog_Iter it;
+    RFID_Record rec;
+    uint16_t count = 0;
+    char buf[64];
+
+    RFIDLog_Flush();
+    uint8_t full = RFIDLog_BeginDay(&it, stamp);
+    sprintf(buf, "Log 20%02lu-%02lu-%02lu%s:\r\n", RFIDREC_YEAR(stamp),
+            RFIDREC_MONTH(stamp), RFIDREC_DAY(stamp), full ? " (not indexed)" : "");
+    PrintMsg(buf);
+    while (RFIDLog_Next(&it, &rec) != RFIDLOG_ITER_END) {
+        sprintf(buf, "%02lu:%02lu:%02lu ", RFIDREC_HOUR(rec.stamp),
+                RFIDREC_MINUTE(rec.stamp), RFIDREC_SECOND(rec.stamp));
+        PrintMsg(buf);
+        PrintHex(rec.uid, RFIDREC_INFO_UID_SIZE(rec.info));
+        sprintf(buf, "status %u\r\n", RFIDREC_INFO_STATUS(rec.info));
+        PrintMsg(buf);
+        count++;
+    }
+    sprintf(buf, "%u taps\r\n", count);
+    PrintMsg(buf);
+}
+
+// Export the rolled-up days of one month: first and last tap per card
+void Print_Month_Summary(uint32_t stamp) {
+    RFIDLog_SumIter it;
+    RFIDLog_Summary sum;
+    uint32_t year = RFIDREC_YEAR(stamp);
+    uint32_t month = RFIDREC_MONTH(stamp);
+    uint32_t next = (month == 12) ? RFIDREC_STAMP(year + 1, 1, 1, 0, 0, 0)
+                                  : RFIDREC_STAMP(year, month + 1, 1, 0, 0, 0);
+    uint16_t count = 0;
+    char buf[64];
+
+    sprintf(buf, "Summary 20%02lu-%02lu:\r\n", year, month);
+    PrintMsg(buf);
+    RFIDLog_BeginSummary(&it, RFIDREC_STAMP(year, month, 1, 0, 0, 0),
+                         RFIDRec_SecondsToStamp(RFIDRec_StampToSeconds(next) - 86400));
+    while (RFIDLog_NextSummary(&it, &sum) == 0) {
+        sprintf(buf, "%02lu %02lu:%02lu-%02lu:%02lu ", RFIDREC_DAY(sum.first),
+                RFIDREC_HOUR(sum.first), RFIDREC_MINUTE(sum.first),
+                RFIDREC_HOUR(sum.last), RFIDREC_MINUTE(sum.last));
+        PrintMsg(buf);
+        PrintHex(sum.uid, sum.uidSize);
+        PrintMsg("\r\n");
+        count++;
+    }
+    sprintf(buf, "%u card days\r\n", count);
+    PrintMsg(buf);
+}
+
+#ifdef LOG_SCAN_BENCHMARK
+// Full log scan, one read per record against the burst iterator
+void Benchmark_Log_Scan(void) {
+    RFIDLog_Iter it;
+    RFID_Record rec;
+    uint16_t count = RFIDLog_Count();
+    uint32_t t0, single, burst;
+    char buf[80];
+
+    if (count == 0) return;
+    RFIDLog_Flush();
+
+    t0 = HAL_GetTick();
+    for (uint16_t i = 0; i < count; i++) RFIDLog_Read(i, &rec);
+    single = HAL_GetTick() - t0;
+
+    t0 = HAL_GetTick();
+    RFIDLog_Begin(&it);
+    while (RFIDLog_Next(&it, &rec) != RFIDLOG_ITER_END) {}
+    burst = HAL_GetTick() - t0;
+
+    sprintf(buf, "Log scan %u rec: single %lu rec/s, burst %lu rec/s\r\n",
+            count, (count * 1000UL) / (single ? single : 1),
+            (count * 1000UL) / (burst ? burst : 1));
+    PrintMsg(buf);
+}
+#endif
+
+#ifdef I2C_BACKEND_BENCHMARK
+// Average bus time of one EEPROM transfer in us, write cycles taken out
+static uint32_t Bench_Transfer_Us(uint16_t addr, uint8_t *data, uint16_t len,
+                                  uint8_t write, uint16_t rounds) {
+    uint32_t cycles = AT24Cxx_GetWriteStats()->TotalUs;
+    uint32_t t0 = HAL_GetTick();
+
+    for (uint16_t i = 0; i < rounds; i++) {
+        if (write) AT24Cxx_WriteByte(addr, data, len);
+        else AT24Cxx_ReadByte(addr, data, len);
+    }
+    uint32_t total = (HAL_GetTick() - t0) * 1000UL;
+    cycles = AT24Cxx_GetWriteStats()->TotalUs - cycles;
+    return (total > cycles) ? (total - cycles) / rounds : 0;
+}
+
+// Per transaction and per byte cost of both I2C backends on the last
+// EEPROM page, which is written with its own content and restored
+void Benchmark_I2C_Backends(void) {
+    static const char *const names[] = { "HAL", "LL" };
+    uint16_t page = AT24Cxx_PageSize();
+    uint32_t end = (AT24Cxx_Size() < 0x10000UL) ? AT24Cxx_Size() : 0x10000UL;
+    uint16_t addr = (uint16_t)(end - page);
+    uint8_t saved[AT24Cxx_PAGE_SIZE_MAX];
+    uint8_t data[AT24Cxx_PAGE_SIZE_MAX];
+    AT24Cxx_Backend keep = AT24Cxx_GetBackend();
+    char buf[96];
+
+    RFIDLog_Sync();
+    if (AT24Cxx_ReadByte(addr, saved, page) != 0) {
+        PrintMsg("I2C benchmark: EEPROM read failed\r\n");
+        return;
+    }
+
+    for (uint8_t b = AT24Cxx_BACKEND_HAL; b <= AT24Cxx_BACKEND_LL; b++) {
+        AT24Cxx_SetBackend((AT24Cxx_Backend)b);
+        memcpy(data, saved, page);
+        uint32_t rd1 = Bench_Transfer_Us(addr, data, 1, 0, 200);
+        uint32_t rdN = Bench_Transfer_Us(addr, data, page, 0, 200);
+        uint32_t wr1 = Bench_Transfer_Us(addr, saved, 1, 1, 20);
+        uint32_t wrN = Bench_Transfer_Us(addr, saved, page, 1, 20);
+
+        sprintf(buf, "I2C %s: read %luus/xfer %luns/B, write %luus/xfer %luns/B\r\n",
+                names[b], rd1, (rdN > rd1) ? (rdN - rd1) * 1000UL / (page - 1) : 0,
+                wr1, (wrN > wr1) ? (wrN - wr1) * 1000UL / (page - 1) : 0);
+        PrintMsg(buf);
+    }
+
+    AT24Cxx_SetBackend(keep);
+    AT24Cxx_WriteByte(addr, saved, page);
+}
+#endif
+
+#ifdef RFID_CRC_BENCHMARK
+// Average time of one block read with each CRC_A source, on sector 2 of the
+// selected card
+void Benchmark_CRC_Modes(void) {
+    static const char *const names[] = { "table", "chip", "frame" };
+    uint8_t keep = rfid.crc_mode;
+    uint8_t buffer[18];
+    char buf[64];
+
+    if (MFRC522_Authenticate(&rfid, 11, &key, &rfid.uid) != MFRC522_OK) {
+        PrintMsg("CRC benchmark: auth failed\r\n");
+        return;
     }
 
-    // 5. Write Log Data
-    AT24Cxx_WriteByte(writeAddr, (uint8_t*)&newLog, sizeof(RFID_Log));
-    HAL_Delay(10); // CRITICAL: EEPROM Write Cycle Time
+    for (uint8_t m = MFRC522_CRC_TABLE; m <= MFRC522_CRC_FRAME; m++) {
+        uint16_t ok = 0;
+        rfid.crc_mode = m;
+        uint32_t t0 = HAL_GetTick();
+        for (uint16_t i = 0; i < 100; i++) {
+            if (MFRC522_ReadBlock(&rfid, 8, buffer) == MFRC522_OK) ok++;
+        }
+        uint32_t us = (HAL_GetTick() - t0) * 10UL;
+
+        sprintf(buf, "CRC %s: %luus/read, %u/100 ok\r\n", names[m], us, ok);
+        PrintMsg(buf);
+    }
 
-    // 6. Update Counter
-    logCount++;
-    AT24Cxx_WriteByte(0x0000, (uint8_t*)&logCount, 2);
-    HAL_Delay(10); // CRITICAL: EEPROM Write Cycle Time
+    rfid.crc_mode = keep;
+}
+#endif
+
+// Background log maintenance: a wipe page, a directory update or a roll-up
+// batch per call, wipe progress in 10% steps
+void Log_Maintenance_Step(void) {
+    static uint8_t lastDone = 100;
+    uint8_t done = RFIDLog_Maintain();
+
+    if (done != lastDone && (done == 100 || lastDone == 100 || done / 10 != lastDone / 10)) {
+        char buf[32];
+        sprintf(buf, "Log erase: %u%%\r\n", done);
+        PrintMsg(buf);
+    }
+    lastDone = done;
 }
 
 /* --- LCD Helper Functions --- */
@@ -168,36 +406,47 @@ void LCD_Show_Scan_Screen() {
     // Optional: Show current time on second line
     RTC_TimeTypeDef sTime;
     RTC_DateTypeDef sDate;
-    DS3231_GetDateTime(&sTime, &sDate);
     char timeStr[16];
-    sprintf(timeStr, "%02d:%02d:%02d", sTime.Hours, sTime.Minutes, sTime.Seconds);
+    if (DS3231_GetDateTime(&sTime, &sDate) != 0) strcpy(timeStr, "--:--:--");
+    else sprintf(timeStr, "%02d:%02d:%02d", sTime.Hours, sTime.Minutes, sTime.Seconds);
     lcd_put_cur(1, 4);
     lcd_send_string(timeStr);
 }
 
 void LCD_Show_Log(uint16_t index, uint16_t total) {
-    RFID_Log tempLog;
-    uint16_t readAddr = 2 + (index * LOG_SIZE);
-    AT24Cxx_ReadByte(readAddr, (uint8_t*)&tempLog, LOG_SIZE);
+    RFID_Record rec;
+    uint8_t bad = RFIDLog_Read(index, &rec);
 
     lcd_clear();
 
     char line1[20];
     char line2[20];
 
-    // Line 1: Clean UID display
-    sprintf(line1, "%d:%02X%02X%02X%02X",
-            index + 1,
-            tempLog.uid[0], tempLog.uid[1],
-            tempLog.uid[2], tempLog.uid[3]);
+    if (bad) {
+        sprintf(line1, "%d:", index + 1);
+        lcd_put_cur(0, 0);
+        lcd_send_string(line1);
+        lcd_put_cur(1, 0);
+        lcd_send_string(bad == 2 ? "No event (gap)" : "Record corrupt");
+        return;
+    }
+
+    // Line 1: Clean UID display, a 7 or 10 byte UID loses its leading
+    // (manufacturer) bytes when it does not fit the 16 columns
+    uint8_t size = RFIDREC_INFO_UID_SIZE(rec.info);
+    int len = sprintf(line1, "%d:", index + 1);
+    uint8_t first = (size * 2 > 16 - len) ? size - (16 - len) / 2 : 0;
+    for (uint8_t i = first; i < size; i++) {
+        len += sprintf(&line1[len], "%02X", rec.uid[i]);
+    }
 
     lcd_put_cur(0, 0);
     lcd_send_string(line1);
 
     // Line 2: Date and Time
     sprintf(line2, "D:%02d/%02d T:%02d:%02d",
-            tempLog.day, tempLog.month,
-            tempLog.hour, tempLog.minute);
+            RFIDREC_DAY(rec.stamp), RFIDREC_MONTH(rec.stamp),
+            RFIDREC_HOUR(rec.stamp), RFIDREC_MINUTE(rec.stamp));
 
     lcd_put_cur(1, 0);
     lcd_send_string(line2);
@@ -233,6 +482,7 @@ int main(void)
   HAL_Init();
   SystemClock_Config();
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_I2C2_Init();
   MX_SPI1_Init();
   MX_USART1_UART_Init();
@@ -243,21 +493,61 @@ int main(void)
   lcd_init();
   LCD_Show_Scan_Screen();
 
-  // CLEARING THE EXISTING LOGS =======================
-  uint16_t zero = 0;
-  AT24Cxx_WriteByte(0x0000, (uint8_t*)&zero, 2); // Reset count to 0
-
-  uint8_t clearBuf[LOG_SIZE] = {0};
-  for(int i=0; i<10; i++) {
-      AT24Cxx_WriteByte(2 + (i * LOG_SIZE), clearBuf, LOG_SIZE);
+  // Load the log header (probes the EEPROM, converts a legacy 12 byte log).
+  // A log that cannot be read is left alone, keep trying until it can.
+  while (RFIDLog_Init() != 0) {
+      lcd_clear();
+      lcd_put_cur(0, 0);
+      lcd_send_string("EEPROM Error");
+      lcd_put_cur(1, 0);
+      lcd_send_string("Retrying...");
+      PrintMsg("Log: EEPROM read failed, retrying\r\n");
+      HAL_Delay(1000);
+  }
+  LCD_Show_Scan_Screen();
+  RFIDLog_SetEvictHandler(Log_Entry_Evicted);
+  Print_EEPROM_Geometry();
+  if (RFIDLog_Recovered()) PrintMsg("Log: torn page repaired\r\n");
+
+  // Today's taps so far
+  RTC_TimeTypeDef bootTime;
+  RTC_DateTypeDef bootDate;
+  if (DS3231_GetDateTime(&bootTime, &bootDate) != 0) {
+      PrintMsg("RTC read failed, no day log\r\n");
+  } else {
+      Print_Day_Log(RFIDREC_STAMP(bootDate.Year, bootDate.Month, bootDate.Date, 0, 0, 0));
+      Print_Month_Summary(RFIDREC_STAMP(bootDate.Year, bootDate.Month, bootDate.Date, 0, 0, 0));
+  }
+#ifdef LOG_SCAN_BENCHMARK
+  Benchmark_Log_Scan();
+#endif
+#ifdef I2C_BACKEND_BENCHMARK
+  Benchmark_I2C_Backends();
+#endif
+
+  // Records survive a reset. Holding PREV and NEXT at power-up wipes the
+  // log: it is empty at once, the old records are erased in the background
+  // while the field is quiet
+  if (HAL_GPIO_ReadPin(BTN_PORT, BTN_PREV_PIN) == GPIO_PIN_RESET &&
+      HAL_GPIO_ReadPin(BTN_PORT, BTN_NEXT_PIN) == GPIO_PIN_RESET) {
+      if (RFIDLog_Wipe() == 0) PrintMsg("Log cleared, erasing old records\r\n");
+      else PrintMsg("Log clear failed\r\n");
   }
-  //===============================
+
+  Rebuild_UID_Index();
 
   rfid.hspi = &hspi1;
   rfid.cs_port = GPIOA;
   rfid.cs_pin = GPIO_PIN_4;
   rfid.rst_port = GPIOB;
   rfid.rst_pin = GPIO_PIN_0;
+#ifdef RFID_SPI_DMA
+  rfid.use_dma = 1;
+#endif
+#ifdef RFID_IRQ_WIRED
+  rfid.irq_port = RFID_IRQ_PORT;
+  rfid.irq_pin = RFID_IRQ_PIN;
+#endif
   MFRC522_Init(&rfid);
 
   // Initialize Key
@@ -273,6 +563,7 @@ int main(void)
   uint8_t inViewMode = 0;
   const uint32_t DEBOUNCE_DELAY = 200; // 200ms debounce
   uint32_t lastDebounceTime = 0;
+  uint32_t lastCardTime = 0;
 
   while (1)
   {
@@ -280,6 +571,10 @@ int main(void)
 
 	  uint32_t currentMillis = HAL_GetTick();
 
+	      // Write back staged log records that have waited too long
+	      RFIDLog_Poll();
+	      AT24Cxx_Poll();
+
 	      // --- PART 1: BUTTON LOGIC (Active Low: RESET = Pressed) ---
 	      // Check if enough time has passed since last press (Debouncing)
 	      if (currentMillis - lastDebounceTime > DEBOUNCE_DELAY)
@@ -293,10 +588,9 @@ int main(void)
 	              lastInteractionTime = currentMillis;  // Reset inactivity timeout
 
 	              // Read Total Logs
-	              uint16_t totalLogs = 0;
-	              AT24Cxx_ReadByte(0x0000, (uint8_t*)&totalLogs, 2);
+	              uint16_t totalLogs = RFIDLog_Count();
 
-	              if (totalLogs == 0xFFFF || totalLogs == 0) {
+	              if (totalLogs == 0) {
 	                  lcd_clear();
 	                  lcd_put_cur(0,0);
 	                  lcd_send_string("No Logs Saved");
@@ -338,6 +632,14 @@ int main(void)
 
 	      // --- PART 2: RFID LOGIC (Unchanged) ---
 	      if (!MFRC522_IsNewCardPresent(&rfid)) {
+	          // No card in the field: run maintenance and empty the staging buffer
+	          Log_Maintenance_Step();
+	          if (HAL_GetTick() - lastCardTime > LOG_IDLE_FLUSH_MS) {
+	              uint32_t pageWrites = AT24Cxx_GetWriteStats()->Count;
+	              RFIDLog_Flush();
+	              if (AT24Cxx_GetWriteStats()->Count != pageWrites) Print_EEPROM_Stats();
+	          }
+
 	          // Update time on LCD every second if idle
 	          static uint32_t lastTimeUpdate = 0;
 	          if (HAL_GetTick() - lastTimeUpdate > 1000) {
@@ -351,6 +653,13 @@ int main(void)
 	      if (!MFRC522_ReadCardSerial(&rfid)) {
 	          continue;
 	      }
+#ifdef RFID_CRC_BENCHMARK
+	      static uint8_t crcBenchDone = 0;
+	      if (!crcBenchDone) {
+	          crcBenchDone = 1;
+	          Benchmark_CRC_Modes();
+	      }
+#endif
 
 	      //=============WRITE TO SECTOR AND BLOCK===================
 	      uint8_t my_data[16] = "73611F90________"; // 16 bytes
@@ -371,14 +680,22 @@ int main(void)
 	      PrintHex(rfid.uid.uidByte, rfid.uid.size);
 	      PrintMsg("\r\n");
 
-	      if (Is_Card_Already_Logged(rfid.uid.uidByte)) {
+	      uint8_t logResult;
+	      if (Is_Card_Already_Logged(rfid.uid.uidByte, rfid.uid.size)) {
 	          lcd_clear();
 	          lcd_put_cur(0, 1);
 	          lcd_send_string("Already Logged");
 	          PrintMsg("Status: Already Logged\r\n");
 	          HAL_Delay(1500);
+	      } else if ((logResult = Log_RFID_Event(rfid.uid.uidByte, rfid.uid.size, 1)) != 0) {
+	          lcd_clear();
+	          lcd_put_cur(0, 0);
+	          lcd_send_string(logResult == 2 ? "Clock Error:" : "Log Full: Card");
+	          lcd_put_cur(1, 0);
+	          lcd_send_string("Not Saved");
+	          PrintMsg("Status: Not Logged\r\n");
+	          HAL_Delay(1500);
 	      } else {
-	          Log_RFID_Event(rfid.uid.uidByte, 1);
 	          lcd_clear();
 	          lcd_put_cur(0, 2);
 	          lcd_send_string("Card Logged!");
@@ -420,6 +737,7 @@ int main(void)
       MFRC522_Halt(&rfid);
       MFRC522_StopCrypto1(&rfid);
       HAL_Delay(100);
+      lastCardTime = HAL_GetTick();
   }
 }
 
@@ -491,6 +809,19 @@ static void MX_USART1_UART_Init(void) {
   HAL_UART_Init(&huart1);
 }
 
+static void MX_DMA_Init(void) {
+  /* DMA controller clock enable */
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  /* DMA interrupt init */
+  /* DMA1_Channel2_3_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel2_3_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel2_3_IRQn);
+  /* DMA1_Channel4_5_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel4_5_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel4_5_IRQn);
+}
+
 static void MX_GPIO_Init(void) {
   GPIO_InitTypeDef GPIO_InitStruct = {0};
 
@@ -520,8 +851,42 @@ static void MX_GPIO_Init(void) {
   GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
   GPIO_InitStruct.Pull = GPIO_PULLUP;
   HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+#ifdef RFID_IRQ_WIRED
+  /* MFRC522 IRQ: push-pull, active low */
+  GPIO_InitStruct.Pin = RFID_IRQ_PIN;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING;
+  GPIO_InitStruct.Pull = GPIO_PULLUP;
+  HAL_GPIO_Init(RFID_IRQ_PORT, &GPIO_InitStruct);
+
+  HAL_NVIC_SetPriority(EXTI0_1_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(EXTI0_1_IRQn);
+#endif
 }
 
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
+  if (GPIO_Pin == RFID_IRQ_PIN) MFRC522_IrqCallback(&rfid);
+}
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi) {
+  if (hspi == rfid.hspi) MFRC522_DmaCallback(&rfid, true);
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) {
+  if (hspi == rfid.hspi) MFRC522_DmaCallback(&rfid, false);
+}
+
+
+// Wait until an asynchronous (DMA) transfer has released hi2c2. The EEPROM
+// driver only finishes or aborts a stuck transfer from its poll, so keep it
+// running and wait a little longer than its transfer timeout
+void I2C2_WaitIdle(void) {
+  uint32_t start = HAL_GetTick();
+  while (HAL_I2C_GetState(&hi2c2) != HAL_I2C_STATE_READY) {
+    AT24Cxx_Poll();
+    if (HAL_GetTick() - start > AT24Cxx_XFER_TIMEOUT + 10) break;
+  }
+}
 
 void Error_Handler(void) {
   __disable_irq();
@@ -0,0 +1,2922 @@
+/**
+  ******************************************************************************
+  * @file    rfid_log.c
+  * @brief   EEPROM attendance log: ring of sequence-numbered records with a
+  *          write-combining staging buffer
+  ******************************************************************************
+  */
+#include "rfid_log.h"
+
+/* Ring geometry: slots are grouped in 32 byte blocks, a compact block starts
+ * with its base */
+#ifdef RFIDLOG_COMPACT
+#define RFIDLOG_SLOT_SIZE		RFIDCMP_EVENT_SIZE
+#define RFIDLOG_SLOT_OFFSET		RFIDCMP_BASE_SIZE
+#define RFIDLOG_THIS_LAYOUT		RFIDLOG_LAYOUT_COMPACT
+#define RFIDLOG_DAY_END			rosterAddr
+#else
+#define RFIDLOG_SLOT_SIZE		RFIDREC_SIZE
+#define RFIDLOG_SLOT_OFFSET		0
+#define RFIDLOG_THIS_LAYOUT		RFIDLOG_LAYOUT
+#define RFIDLOG_DAY_END			endAddr
+#endif
+#define RFIDLOG_RING_END		sumAddr
+#define RFIDLOG_BLOCK_SIZE		RFIDLOG_RING_BLOCK
+#define RFIDLOG_BLOCK_SLOTS		((RFIDLOG_BLOCK_SIZE - RFIDLOG_SLOT_OFFSET) / RFIDLOG_SLOT_SIZE)
+#ifdef RFIDLOG_COMPACT
+#define RFIDLOG_EVICT_SLOTS		RFIDLOG_BLOCK_SLOTS	// Old records go per block
+#else
+#define RFIDLOG_EVICT_SLOTS		1
+#endif
+#define RFIDLOG_LAP_FAILED		0xFE	// RFIDLog_SlotLap(): slot could not be read
+
+static RFIDLog_Header hdr;		// Copy of the header in EEPROM
+static uint16_t head;			// Next slot to write in the current pass
+static uint16_t capacity;		// Record slots in the ring
+static uint16_t endAddr;		// End of the log, EEPROM size probed at boot
+
+/* Daily summaries: ring of blocks, the next one goes to sumHead */
+static uint16_t sumAddr;
+static uint16_t sumBlocks;		// Blocks that fit the EEPROM
+static uint16_t sumHead;
+static uint8_t sumLap;			// Lap of the blocks below sumHead
+
+/* Roll-up in progress: the batch summarises the records [rollFrom, rollSeq)
+ * of the oldest run, which ends at rollEnd. Without one, the search for the
+ * end of the oldest day has got to rollScan. */
+typedef struct {
+	uint8_t uid[RFIDREC_UID_MAX];
+	uint8_t size;
+	uint8_t reserved;
+	uint16_t first;				// Minute of the day
+	uint16_t last;
+} RFIDLog_RollEntry;
+
+static uint8_t rollActive;
+static uint8_t rollCount;		// Entries in rollBatch, all of date rollDate
+static uint16_t rollDate;
+static uint16_t rollScanDate;	// Date of the oldest record up to rollScan
+static uint32_t rollFrom;		// Log start the state belongs to
+static uint32_t rollSeq;
+static uint32_t rollEnd;
+static uint32_t rollScan;
+static RFIDLog_RollEntry rollBatch[RFIDLOG_ROLLUP_BATCH];
+
+/* UID directory: valid prefix of sorted entries, filled by RFIDLog_Maintain()
+ * one record at a time from dirSeq on */
+static uint16_t dirAddr;
+static uint16_t dirSlots;		// Entries that fit the EEPROM, 0 = no directory
+static uint16_t dirCount;
+static uint8_t dirFull;			// A UID was left out, lookups are not conclusive
+static uint8_t dirRebuild;		// Entering every record again: 1, 2 = after an erase
+static uint8_t dirVerify;		// Entries counted and checked after a boot
+static uint32_t dirSeq;			// Oldest record not entered yet
+static uint16_t dirErase;		// End of the entries still to erase for a rebuild
+static uint16_t dirMoveEnd;		// End of the entries still to move up, 0 = none
+static uint16_t dirMovePos;		// Where dirKey goes once they are moved
+static RFIDLog_DirEntry dirKey;
+
+/* Day index: the newest entry and where the next one goes */
+static uint16_t dayAddr;
+static uint16_t daySlots;		// Entries that fit the EEPROM
+static uint16_t dayNext;
+static uint16_t dayDate;		// Date of the newest entry, RFIDLOG_ANY_DATE if none
+static uint32_t daySeq;
+
+#ifdef RFIDLOG_COMPACT
+static uint32_t blockSeconds;	// Time of the last event in the head block
+static uint16_t rosterCount;
+static uint16_t rosterSize;		// Entries that fit the EEPROM
+static uint16_t rosterAddr;
+static uint8_t rosterTag[RFIDLOG_ROSTER_SIZE];	// CRC-8 of each roster UID
+static uint8_t rosterFree[RFIDLOG_ROSTER_SIZE / 8];	// Erased entries below rosterCount
+static uint16_t rosterFreeCount;
+
+/* Roster reclaim: a scan over the log marks the entries its events refer
+ * to, the others are erased one per step and reused */
+static uint8_t rosterScan;		// RFIDLOG_ROSTER_IDLE, _MARK or _ERASE
+static uint8_t rosterScanned;	// rosterScanFirst holds the start of a scan
+static uint16_t rosterCursor;	// Next entry to erase
+static uint32_t rosterSeq;		// Next record to mark
+static uint32_t rosterEnd;		// Head when the scan started
+static uint32_t rosterScanFirst;	// Oldest record when the scan started
+static uint8_t rosterUsed[RFIDLOG_ROSTER_SIZE / 8];
+#endif
+
+/* Staged bytes, stageBuf[0] belongs at EEPROM address stageAddr */
+static uint8_t stageBuf[RFIDLOG_STAGE_SIZE];
+static uint16_t stageAddr;
+static uint16_t stageLen;
+static uint32_t stageTick;		// Time the oldest staged byte was added
+
+/* Write-back in progress on the asynchronous EEPROM queue */
+static uint8_t flightBuf[RFIDLOG_STAGE_SIZE];
+static uint8_t flightPending;	// Queued requests not completed yet
+static uint16_t writeErrors;
+static uint16_t recovered;		// Torn pages repaired by RFIDLog_Init()
+static RFIDLog_EvictFn evictHandler;
+static uint32_t wipeTotal;		// Bytes of the background wipe, 0 = none
+
+/* Read cache: EEPROM lines under the staging buffer, the least recently used
+ * line is replaced first. Browsing prefetches the next line on the
+ * asynchronous queue. */
+typedef enum {
+	RFIDLOG_LINE_FREE = 0,
+	RFIDLOG_LINE_VALID,
+	RFIDLOG_LINE_FILLING,		// Prefetch queued, data owned by the DMA
+	RFIDLOG_LINE_STALE			// Written while filling, dropped when done
+} RFIDLog_LineState;
+
+typedef struct {
+	uint16_t addr;
+	uint8_t state;
+	uint8_t age;				// 0 = used last
+	uint8_t data[RFIDLOG_CACHE_LINE];
+} RFIDLog_Line;
+
+static RFIDLog_Line cache[RFIDLOG_CACHE_LINES];
+static uint16_t lastIndex;		// Log index read last, gives the direction
+
+/* Cache ---------------------------------------------------------------------*/
+static void RFIDLog_CacheTouch(RFIDLog_Line *Line)
+{
+	for (uint8_t i = 0; i < RFIDLOG_CACHE_LINES; i++)
+	{
+		if (cache[i].age < Line->age)
+		{
+			cache[i].age++;
+		}
+	}
+	Line->age = 0;
+}
+
+static RFIDLog_Line *RFIDLog_CacheFind(uint16_t LineAddr)
+{
+	for (uint8_t i = 0; i < RFIDLOG_CACHE_LINES; i++)
+	{
+		if (cache[i].state != RFIDLOG_LINE_FREE && cache[i].addr == LineAddr)
+		{
+			return &cache[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+  * @brief  Line to load next: a free one, else the least recently used
+  * @retval NULL if every line waits for a prefetch
+  */
+static RFIDLog_Line *RFIDLog_CacheVictim(void)
+{
+	RFIDLog_Line *Victim = NULL;
+
+	for (uint8_t i = 0; i < RFIDLOG_CACHE_LINES; i++)
+	{
+		if (cache[i].state == RFIDLOG_LINE_FREE)
+		{
+			return &cache[i];
+		}
+		if (cache[i].state == RFIDLOG_LINE_VALID &&
+				(Victim == NULL || cache[i].age > Victim->age))
+		{
+			Victim = &cache[i];
+		}
+	}
+	return Victim;
+}
+
+/**
+  * @brief  Keep the cached lines in step with bytes written to EEPROM
+  * @param  pData	Written bytes, NULL drops the lines instead
+  */
+static void RFIDLog_CacheUpdate(uint16_t Addr, const uint8_t *pData,
+		uint32_t Len)
+{
+	for (uint8_t i = 0; i < RFIDLOG_CACHE_LINES; i++)
+	{
+		RFIDLog_Line *Line = &cache[i];
+		uint32_t Start = (Addr > Line->addr) ? Addr : Line->addr;
+		uint32_t End = Line->addr + RFIDLOG_CACHE_LINE;
+
+		if (Addr + Len < End)
+		{
+			End = Addr + Len;
+		}
+		if (Line->state == RFIDLOG_LINE_FREE || Start >= End)
+		{
+			continue;
+		}
+
+		if (Line->state != RFIDLOG_LINE_VALID)
+		{
+			Line->state = RFIDLOG_LINE_STALE;
+		}
+		else if (pData == NULL)
+		{
+			Line->state = RFIDLOG_LINE_FREE;
+		}
+		else
+		{
+			memcpy(&Line->data[Start - Line->addr], &pData[Start - Addr],
+					End - Start);
+		}
+	}
+}
+
+/**
+  * @brief  Drop every line, the ages start out distinct
+  */
+static void RFIDLog_CacheReset(void)
+{
+	RFIDLog_CacheUpdate(0, NULL, AT24Cxx_EEPROM_SIZE_MAX);
+	for (uint8_t i = 0; i < RFIDLOG_CACHE_LINES; i++)
+	{
+		cache[i].age = i;
+	}
+}
+
+static void RFIDLog_CacheFilled(uint8_t Status, void *Context)
+{
+	RFIDLog_Line *Line = Context;
+
+	Line->state = (Status == 0 && Line->state == RFIDLOG_LINE_FILLING) ?
+			RFIDLOG_LINE_VALID : RFIDLOG_LINE_FREE;
+}
+
+/**
+  * @brief  Read EEPROM bytes through the cache
+  */
+static void RFIDLog_CacheRead(uint16_t Addr, uint8_t *pData, uint16_t Len)
+{
+	while (Len > 0)
+	{
+		uint16_t LineAddr = Addr - (Addr % RFIDLOG_CACHE_LINE);
+		uint16_t Part = RFIDLOG_CACHE_LINE - (Addr - LineAddr);
+		RFIDLog_Line *Line = RFIDLog_CacheFind(LineAddr);
+
+		if (Part > Len)
+		{
+			Part = Len;
+		}
+		if (Line != NULL && Line->state != RFIDLOG_LINE_VALID)
+		{
+			/* Prefetched line still on the queue */
+			AT24Cxx_Sync();
+			Line = RFIDLog_CacheFind(LineAddr);
+		}
+		if (Line == NULL)
+		{
+			Line = RFIDLog_CacheVictim();
+			if (Line == NULL || AT24Cxx_ReadByte(LineAddr, Line->data,
+					RFIDLOG_CACHE_LINE) != 0)
+			{
+				if (Line != NULL)
+				{
+					Line->state = RFIDLOG_LINE_FREE;
+				}
+				AT24Cxx_ReadByte(Addr, pData, Part);
+				Line = NULL;
+			}
+			else
+			{
+				Line->addr = LineAddr;
+				Line->state = RFIDLOG_LINE_VALID;
+			}
+		}
+		if (Line != NULL)
+		{
+			memcpy(pData, &Line->data[Addr - LineAddr], Part);
+			RFIDLog_CacheTouch(Line);
+		}
+
+		Addr += Part;
+		pData += Part;
+		Len -= Part;
+	}
+}
+
+/**
+  * @brief  Queue the read of the ring line next to Addr
+  * @param  Up	1 = towards newer records, 0 = towards older ones
+  */
+static void RFIDLog_Prefetch(uint16_t Addr, uint8_t Up)
+{
+	uint16_t LineAddr = Addr - (Addr % RFIDLOG_CACHE_LINE);
+	uint16_t First = RFIDLOG_BASE_ADDR - (RFIDLOG_BASE_ADDR % RFIDLOG_CACHE_LINE);
+	uint16_t Last = (RFIDLOG_RING_END - 1) -
+			((RFIDLOG_RING_END - 1) % RFIDLOG_CACHE_LINE);
+
+	if (Up)
+	{
+		LineAddr = (LineAddr >= Last) ? First : LineAddr + RFIDLOG_CACHE_LINE;
+	}
+	else
+	{
+		LineAddr = (LineAddr <= First) ? Last : LineAddr - RFIDLOG_CACHE_LINE;
+	}
+
+	if (RFIDLog_CacheFind(LineAddr) != NULL)
+	{
+		return;
+	}
+	RFIDLog_Line *Line = RFIDLog_CacheVictim();
+	if (Line == NULL)
+	{
+		return;
+	}
+
+	Line->addr = LineAddr;
+	Line->state = RFIDLOG_LINE_FILLING;
+	RFIDLog_CacheTouch(Line);
+	if (AT24Cxx_ReadAsync(LineAddr, Line->data, RFIDLOG_CACHE_LINE,
+			RFIDLog_CacheFilled, Line) != 0)
+	{
+		Line->state = RFIDLOG_LINE_FREE;
+	}
+}
+
+/**
+  * @brief  Write bytes to EEPROM, blocking, and update the cache
+  * @retval Success = 0, Failed = 1
+  */
+static uint8_t RFIDLog_Write(uint16_t Addr, uint8_t *pData, uint16_t Len)
+{
+	RFIDLog_CacheUpdate(Addr, pData, Len);
+
+	return AT24Cxx_WriteByte(Addr, pData, Len);
+}
+
+static void RFIDLog_WriteDone(uint8_t Status, void *Context)
+{
+	if (Status)
+	{
+		writeErrors++;
+	}
+	flightPending--;
+}
+
+/**
+  * @brief  Write the staged bytes back to EEPROM
+  * @retval Success = 0, Failed = 1 (counted in writeErrors)
+  * @param  All		0 = whole pages only, 1 = everything including the tail
+  * @note   The bytes leave the staging buffer either way, so callers may
+  *			stage more or move stageAddr right after it
+  */
+static uint8_t RFIDLog_WriteBack(uint8_t All)
+{
+	uint16_t End = stageAddr + stageLen;
+	uint8_t Status = 0;
+
+	if (!All)
+	{
+		End -= End % AT24Cxx_PageSize();
+	}
+	if (End <= stageAddr)
+	{
+		return 0;
+	}
+
+	/* Only one write-back at a time, flightBuf is still owned by the DMA */
+	if (flightPending)
+	{
+		AT24Cxx_Sync();
+	}
+
+	uint16_t Len = End - stageAddr;
+	memcpy(flightBuf, stageBuf, Len);
+	RFIDLog_CacheUpdate(stageAddr, flightBuf, Len);
+	if (AT24Cxx_WriteAsync(stageAddr, flightBuf, Len, RFIDLog_WriteDone, NULL)
+			== 0)
+	{
+		flightPending++;
+	}
+	else
+	{
+		/* Queue full of prefetches or erase steps: drain it, then write
+		 * the bytes right away */
+		AT24Cxx_Sync();
+		if (AT24Cxx_WriteByte(stageAddr, flightBuf, Len) != 0)
+		{
+			writeErrors++;
+			Status = 1;
+		}
+	}
+	memmove(stageBuf, stageBuf + Len, stageLen - Len);
+	stageLen -= Len;
+	stageAddr += Len;
+
+	return Status;
+}
+
+static uint16_t RFIDLog_BlockAddr(uint16_t Slot)
+{
+	return RFIDLOG_BASE_ADDR + ((Slot / RFIDLOG_BLOCK_SLOTS) * RFIDLOG_BLOCK_SIZE);
+}
+
+static uint16_t RFIDLog_SlotAddr(uint16_t Slot)
+{
+	return RFIDLog_BlockAddr(Slot) + RFIDLOG_SLOT_OFFSET +
+			((Slot % RFIDLOG_BLOCK_SLOTS) * RFIDLOG_SLOT_SIZE);
+}
+
+/* First byte written together with a slot, the base for a block's first slot */
+static uint16_t RFIDLog_SlotStart(uint16_t Slot)
+{
+	return (Slot % RFIDLOG_BLOCK_SLOTS) ? RFIDLog_SlotAddr(Slot) :
+			RFIDLog_BlockAddr(Slot);
+}
+
+/**
+  * @brief  Read EEPROM bytes, a failed transfer is repeated
+  * @retval Success = 0, Failed = 1 (pData undefined)
+  */
+static uint8_t RFIDLog_ReadRetry(uint16_t Addr, uint8_t *pData, uint16_t Len)
+{
+	for (uint8_t i = 0; i < RFIDLOG_READ_RETRIES; i++)
+	{
+		if (AT24Cxx_ReadByte(Addr, pData, Len) == 0)
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+  * @brief  Read log bytes, the staged part is served from RAM
+  * @param  Cached	1 = through the read cache, 0 = straight from EEPROM
+  * @retval Success = 0, Failed = 1 (uncached reads only)
+  */
+static uint8_t RFIDLog_ReadRaw(uint16_t Addr, uint8_t *pData, uint16_t Len,
+		uint8_t Cached)
+{
+	uint16_t StageEnd = stageAddr + stageLen;
+
+	if (Addr >= stageAddr && Addr + Len <= StageEnd)
+	{
+		memcpy(pData, &stageBuf[Addr - stageAddr], Len);
+		return 0;
+	}
+
+	if (Cached)
+	{
+		RFIDLog_CacheRead(Addr, pData, Len);
+	}
+	else if (RFIDLog_ReadRetry(Addr, pData, Len) != 0)
+	{
+		return 1;
+	}
+	for (uint16_t i = 0; i < Len; i++)
+	{
+		if (Addr + i >= stageAddr && Addr + i < StageEnd)
+		{
+			pData[i] = stageBuf[Addr + i - stageAddr];
+		}
+	}
+	return 0;
+}
+
+/**
+  * @brief  Lap a slot was written in
+  * @retval Lap 0..3, 0xFF if the slot holds no valid data,
+  *			RFIDLOG_LAP_FAILED if it could not be read
+  */
+static uint8_t RFIDLog_SlotLap(uint16_t Slot)
+{
+#ifdef RFIDLOG_COMPACT
+	uint8_t Block[RFIDLOG_BLOCK_SIZE];
+	RFID_CompactBase Base;
+	uint32_t Event;
+	uint16_t Len = RFIDLog_SlotAddr(Slot) + RFIDLOG_SLOT_SIZE -
+			RFIDLog_BlockAddr(Slot);
+
+	if (RFIDLog_ReadRaw(RFIDLog_BlockAddr(Slot), Block, Len, 0) != 0)
+	{
+		return RFIDLOG_LAP_FAILED;
+	}
+	memcpy(&Base, Block, RFIDCMP_BASE_SIZE);
+	memcpy(&Event, &Block[Len - RFIDLOG_SLOT_SIZE], RFIDLOG_SLOT_SIZE);
+	if (!RFIDCmp_BaseIsValid(&Base) || !RFIDCmp_EventIsValid(Event) ||
+			RFIDCMP_EVENT_LAP(Event) != RFIDREC_INFO_LAP(Base.info))
+	{
+		return 0xFF;
+	}
+	return RFIDCMP_EVENT_LAP(Event);
+#else
+	RFID_Record Rec;
+
+	if (RFIDLog_ReadRaw(RFIDLog_SlotAddr(Slot), (uint8_t*)&Rec, RFIDREC_SIZE,
+			0) != 0)
+	{
+		return RFIDLOG_LAP_FAILED;
+	}
+	return RFIDRec_IsValid(&Rec) ? RFIDREC_INFO_LAP(Rec.info) : 0xFF;
+#endif
+}
+
+/**
+  * @brief  Lap of the slot data alone, without the block base
+  * @retval Like RFIDLog_SlotLap()
+  */
+static uint8_t RFIDLog_DataLap(uint16_t Slot)
+{
+#ifdef RFIDLOG_COMPACT
+	uint32_t Event;
+
+	if (RFIDLog_ReadRaw(RFIDLog_SlotAddr(Slot), (uint8_t*)&Event,
+			RFIDLOG_SLOT_SIZE, 0) != 0)
+	{
+		return RFIDLOG_LAP_FAILED;
+	}
+	return RFIDCmp_EventIsValid(Event) ? RFIDCMP_EVENT_LAP(Event) : 0xFF;
+#else
+	return RFIDLog_SlotLap(Slot);
+#endif
+}
+
+/**
+  * @brief  Locate the head by bisection, current-pass slots form a prefix
+  * @retval Success = 0, Failed = 1 (a slot could not be read, head kept)
+  */
+static uint8_t RFIDLog_FindHead(void)
+{
+	uint16_t Lo = 0;
+	uint16_t Hi = capacity;
+
+	while (Lo < Hi)
+	{
+		uint16_t Mid = Lo + ((Hi - Lo) / 2);
+		uint8_t Lap = RFIDLog_SlotLap(Mid);
+
+		if (Lap == RFIDLOG_LAP_FAILED)
+		{
+			return 1;
+		}
+		if (Lap == (hdr.pass & 0x03))
+		{
+			Lo = Mid + 1;
+		}
+		else
+		{
+			Hi = Mid;
+		}
+	}
+
+	head = Lo;
+	return 0;
+}
+
+/* Sequence number of the next record and of the oldest record in the log */
+static uint32_t RFIDLog_HeadSeq(void)
+{
+	return ((uint32_t)hdr.pass * capacity) + head;
+}
+
+/**
+  * @brief  Sequence number of the record in a slot
+  * @note   Slots below the head belong to the current pass, the others to
+  *         the previous one. Beyond the head seq if there is none.
+  */
+static uint32_t RFIDLog_SlotSeq(uint16_t Slot)
+{
+	uint32_t Seq = ((uint32_t)hdr.pass * capacity) + Slot;
+
+	if (Slot >= head)
+	{
+		Seq = (hdr.pass == 0) ? 0xFFFFFFFFUL : Seq - capacity;
+	}
+	return Seq;
+}
+
+/**
+  * @brief  Oldest record while the head is at HeadSeq
+  */
+static uint32_t RFIDLog_FirstSeqAt(uint32_t HeadSeq)
+{
+	/* At most one ring of records, older ones have been overwritten. A
+	 * compact block loses its old events as soon as its base is replaced. */
+	uint32_t First = HeadSeq + (RFIDLOG_EVICT_SLOTS - 1);
+	First -= First % RFIDLOG_EVICT_SLOTS;
+	First = (First > capacity) ? First - capacity : 0;
+
+	if (hdr.start > First)
+	{
+		First = hdr.start;
+	}
+	if (First > HeadSeq)
+	{
+		First = HeadSeq;
+	}
+	return First;
+}
+
+static uint32_t RFIDLog_FirstSeq(void)
+{
+	return RFIDLog_FirstSeqAt(RFIDLog_HeadSeq());
+}
+
+/**
+  * @brief  Write the header copy in RAM over the older header copy in EEPROM
+  * @retval Success = 0, Failed = 1
+  */
+static uint8_t RFIDLog_WriteHeader(void)
+{
+	hdr.update++;
+	hdr.crc = RFIDLog_HeaderChecksum(&hdr);
+
+	return RFIDLog_Write(RFIDLOG_HEADER_ADDR + ((hdr.update %
+			RFIDLOG_HEADER_COPIES) * RFIDLOG_HEADER_SIZE), (uint8_t*)&hdr,
+			RFIDLOG_HEADER_SIZE);
+}
+
+/**
+  * @brief  Load the newest valid header copy
+  * @retval Found = 0, no valid copy = 1 (hdr then holds copy 0 as read),
+  *			2 = read failed, hdr unchanged
+  */
+static uint8_t RFIDLog_LoadHeader(void)
+{
+	RFIDLog_Header Copy[RFIDLOG_HEADER_COPIES];
+	uint8_t Found = 0;
+
+	if (RFIDLog_ReadRetry(RFIDLOG_HEADER_ADDR, (uint8_t*)Copy,
+			sizeof(Copy)) != 0)
+	{
+		return 2;
+	}
+	hdr = Copy[0];
+
+	for (uint8_t i = 0; i < RFIDLOG_HEADER_COPIES; i++)
+	{
+		if (Copy[i].magic != RFIDLOG_MAGIC
+				|| Copy[i].layout != RFIDLOG_THIS_LAYOUT
+				|| Copy[i].recordSize != RFIDLOG_SLOT_SIZE
+				|| Copy[i].crc != RFIDLog_HeaderChecksum(&Copy[i]))
+		{
+			continue;
+		}
+		if (!Found || (int16_t)(Copy[i].update - hdr.update) > 0)
+		{
+			hdr = Copy[i];
+			Found = 1;
+		}
+	}
+
+	return !Found;
+}
+
+/**
+  * @brief  Device size and count, kept in the header
+  */
+static uint8_t RFIDLog_Geometry(void)
+{
+	uint8_t Bits = 0;
+
+	for (uint32_t Size = AT24Cxx_DeviceSize(); Size > 1; Size >>= 1)
+	{
+		Bits++;
+	}
+	return RFIDLOG_GEOMETRY(Bits, AT24Cxx_DEV_NUM);
+}
+
+/**
+  * @brief  Start an empty header, the update counter is kept
+  */
+static void RFIDLog_NewHeader(void)
+{
+	hdr.magic = RFIDLOG_MAGIC;
+	hdr.layout = RFIDLOG_THIS_LAYOUT;
+	hdr.recordSize = RFIDLOG_SLOT_SIZE;
+	hdr.pass = 0;
+	hdr.start = 0;
+	hdr.geometry = RFIDLog_Geometry();
+}
+
+/**
+  * @brief  Erase EEPROM from Addr up to End
+  * @retval Success = 0, Failed = 1
+  */
+static uint8_t RFIDLog_Erase(uint16_t Addr, uint16_t End)
+{
+	if (End <= Addr)
+	{
+		return 0;
+	}
+	RFIDLog_CacheUpdate(Addr, NULL, End - Addr);
+
+	return AT24Cxx_Fill(Addr, 0xFF, End - Addr);
+}
+
+#ifdef RFIDLOG_COMPACT
+/* Roster --------------------------------------------------------------------*/
+#define RFIDLOG_ROSTER_IDLE		0
+#define RFIDLOG_ROSTER_MARK		1
+#define RFIDLOG_ROSTER_ERASE	2
+
+#define RFIDLOG_BIT(map, i)		(((map)[(i) / 8] >> ((i) % 8)) & 1)
+#define RFIDLOG_BIT_SET(map, i)	((map)[(i) / 8] |= (uint8_t)(1 << ((i) % 8)))
+#define RFIDLOG_BIT_CLR(map, i)	((map)[(i) / 8] &= (uint8_t)~(1 << ((i) % 8)))
+
+static uint16_t RFIDLog_RosterAddr(uint16_t Index)
+{
+	return rosterAddr + (Index * RFIDREC_SIZE);
+}
+
+/**
+  * @brief  Drop every roster entry
+  * @retval Success = 0, Failed = 1
+  */
+static uint8_t RFIDLog_RosterReset(void)
+{
+	rosterCount = 0;
+	rosterFreeCount = 0;
+	rosterScan = RFIDLOG_ROSTER_IDLE;
+	rosterScanned = 0;
+	memset(rosterFree, 0, sizeof(rosterFree));
+	return RFIDLog_Erase(rosterAddr, endAddr);
+}
+
+/**
+  * @brief  Count the roster entries and collect their tags
+  * @note   New entries go to the lowest erased one, rosterCount is one
+  *         past the highest valid entry
+  */
+static void RFIDLog_RosterLoad(void)
+{
+	RFID_Record Entry;
+
+	rosterCount = 0;
+	rosterFreeCount = 0;
+	rosterScan = RFIDLOG_ROSTER_IDLE;
+	rosterScanned = 0;
+	memset(rosterFree, 0, sizeof(rosterFree));
+	for (uint16_t i = 0; i < rosterSize && i < RFIDCMP_ROSTER_VOID; i++)
+	{
+		AT24Cxx_ReadByte(RFIDLog_RosterAddr(i), (uint8_t*)&Entry,
+				RFIDREC_SIZE);
+		if (!RFIDRec_IsValid(&Entry))
+		{
+			RFIDLOG_BIT_SET(rosterFree, i);
+			continue;
+		}
+		rosterTag[i] = RFIDRec_Crc8(0, Entry.uid,
+				RFIDREC_INFO_UID_SIZE(Entry.info));
+		rosterCount = i + 1;
+	}
+	for (uint16_t i = 0; i < rosterSize; i++)
+	{
+		if (i >= rosterCount)
+		{
+			RFIDLOG_BIT_CLR(rosterFree, i);
+		}
+		rosterFreeCount += RFIDLOG_BIT(rosterFree, i);
+	}
+}
+
+/**
+  * @brief  Roster index of a UID, added if it is new
+  * @retval Roster index, RFIDCMP_ROSTER_VOID if the roster is full
+  */
+static uint16_t RFIDLog_RosterIndex(const RFID_Record *rec)
+{
+	uint8_t Len = RFIDREC_INFO_UID_SIZE(rec->info);
+	uint8_t Tag = RFIDRec_Crc8(0, rec->uid, Len);
+	RFID_Record Entry;
+
+	uint16_t Index = rosterCount;
+
+	for (uint16_t i = 0; i < rosterCount; i++)
+	{
+		if (RFIDLOG_BIT(rosterFree, i))
+		{
+			Index = (Index < i) ? Index : i;
+			continue;
+		}
+		if (rosterTag[i] != Tag)
+		{
+			continue;
+		}
+		AT24Cxx_ReadByte(RFIDLog_RosterAddr(i), (uint8_t*)&Entry,
+				RFIDREC_SIZE);
+		if (RFIDREC_INFO_UID_SIZE(Entry.info) == Len &&
+				memcmp(Entry.uid, rec->uid, Len) == 0)
+		{
+			RFIDLOG_BIT_SET(rosterUsed, i);
+			return i;
+		}
+	}
+
+	if (Index >= rosterSize || Index >= RFIDCMP_ROSTER_VOID)
+	{
+		return RFIDCMP_ROSTER_VOID;
+	}
+
+	/* In EEPROM before any event refers to it. An erased entry is only
+	 * referred to by events that have left the log. */
+	Entry = *rec;
+	Entry.info = RFIDREC_INFO_WITH_LAP(rec->info, 0);
+	Entry.crc = RFIDRec_Checksum(&Entry);
+	if (RFIDLog_Write(RFIDLog_RosterAddr(Index), (uint8_t*)&Entry,
+			RFIDREC_SIZE) != 0)
+	{
+		return RFIDCMP_ROSTER_VOID;
+	}
+	rosterTag[Index] = Tag;
+	RFIDLOG_BIT_SET(rosterUsed, Index);
+	if (Index < rosterCount)
+	{
+		RFIDLOG_BIT_CLR(rosterFree, Index);
+		rosterFreeCount--;
+	}
+	else
+	{
+		rosterCount++;
+	}
+
+	return Index;
+}
+
+/**
+  * @brief  Run one step of the roster reclaim
+  * @retval Work done = 1, 0 otherwise
+  * @note   A scan starts once less than 1/RFIDLOG_ROSTER_RECLAIM of the
+  *         roster is left and a share as big of the ring has been replaced
+  *         since the last one. Appends mark their entries while it runs.
+  */
+static uint8_t RFIDLog_RosterStep(void)
+{
+	uint32_t First = RFIDLog_FirstSeq();
+
+	if (rosterScan == RFIDLOG_ROSTER_IDLE)
+	{
+		if (rosterCount - rosterFreeCount + (rosterSize / RFIDLOG_ROSTER_RECLAIM) <
+				rosterSize || (rosterScanned && First - rosterScanFirst <
+				capacity / RFIDLOG_ROSTER_RECLAIM))
+		{
+			return 0;
+		}
+		memset(rosterUsed, 0, sizeof(rosterUsed));
+		rosterScan = RFIDLOG_ROSTER_MARK;
+		rosterScanned = 1;
+		rosterScanFirst = First;
+		rosterSeq = First;
+		rosterEnd = RFIDLog_HeadSeq();
+		return 1;
+	}
+
+	if (rosterScan == RFIDLOG_ROSTER_MARK)
+	{
+		uint8_t Block[RFIDLOG_BLOCK_SIZE];
+		uint32_t Event;
+
+		if (rosterSeq < First)
+		{
+			rosterSeq = First;
+		}
+		if (rosterSeq >= rosterEnd)
+		{
+			rosterScan = RFIDLOG_ROSTER_ERASE;
+			rosterCursor = 0;
+			return 1;
+		}
+
+		/* One block, the events of the log in it */
+		uint16_t Slot = (uint16_t)(rosterSeq % capacity);
+		uint16_t Start = Slot - (Slot % RFIDLOG_BLOCK_SLOTS);
+		RFIDLog_ReadRaw(RFIDLog_BlockAddr(Slot), Block, RFIDLOG_BLOCK_SIZE, 0);
+		for (; Slot < Start + RFIDLOG_BLOCK_SLOTS && rosterSeq < rosterEnd;
+				Slot++, rosterSeq++)
+		{
+			memcpy(&Event, &Block[RFIDCMP_BASE_SIZE + ((Slot - Start) *
+					RFIDLOG_SLOT_SIZE)], RFIDLOG_SLOT_SIZE);
+			uint16_t Roster = RFIDCMP_EVENT_ROSTER(Event);
+			if (RFIDCmp_EventIsValid(Event) && Roster < rosterCount)
+			{
+				RFIDLOG_BIT_SET(rosterUsed, Roster);
+			}
+		}
+		return 1;
+	}
+
+	while (rosterCursor < rosterCount)
+	{
+		uint16_t i = rosterCursor++;
+		if (RFIDLOG_BIT(rosterFree, i) || RFIDLOG_BIT(rosterUsed, i))
+		{
+			continue;
+		}
+		RFIDLog_Erase(RFIDLog_RosterAddr(i), RFIDLog_RosterAddr(i + 1));
+		RFIDLOG_BIT_SET(rosterFree, i);
+		rosterFreeCount++;
+		return 1;
+	}
+	rosterScan = RFIDLOG_ROSTER_IDLE;
+
+	return 1;
+}
+
+/**
+  * @brief  Seconds of the last event in the block holding slot head - 1
+  */
+static uint32_t RFIDLog_BlockSeconds(void)
+{
+	uint8_t Block[RFIDLOG_BLOCK_SIZE];
+	RFID_CompactBase Base;
+	uint32_t Event;
+	uint32_t Sec;
+	uint16_t First = head - ((head - 1) % RFIDLOG_BLOCK_SLOTS) - 1;
+
+	RFIDLog_ReadRaw(RFIDLog_BlockAddr(First), Block, RFIDLOG_BLOCK_SIZE, 0);
+	memcpy(&Base, Block, RFIDCMP_BASE_SIZE);
+	Sec = RFIDRec_StampToSeconds(Base.stamp);
+	for (uint16_t Slot = First; Slot < head; Slot++)
+	{
+		memcpy(&Event, &Block[RFIDCMP_BASE_SIZE + ((Slot - First) *
+				RFIDLOG_SLOT_SIZE)], RFIDLOG_SLOT_SIZE);
+		Sec += RFIDCMP_EVENT_DELTA(Event);
+	}
+	return Sec;
+}
+#endif
+
+/* Day Index -----------------------------------------------------------------*/
+static uint16_t RFIDLog_DayAddr(uint16_t Entry)
+{
+	return dayAddr + (Entry * RFIDLOG_DAY_SIZE);
+}
+
+/**
+  * @brief  Drop every day index entry
+  * @retval Success = 0, Failed = 1
+  */
+static uint8_t RFIDLog_DayReset(void)
+{
+	dayNext = 0;
+	dayDate = RFIDLOG_ANY_DATE;
+	daySeq = 0;
+	return RFIDLog_Erase(dayAddr, RFIDLOG_DAY_END);
+}
+
+/**
+  * @brief  Find the newest day index entry
+  */
+static void RFIDLog_DayLoad(void)
+{
+	RFIDLog_DayEntry Entry[RFIDLOG_BLOCK_SIZE / RFIDLOG_DAY_SIZE];
+
+	dayNext = 0;
+	dayDate = RFIDLOG_ANY_DATE;
+	daySeq = 0;
+	for (uint16_t i = 0; i < daySlots; i += RFIDLOG_BLOCK_SIZE / RFIDLOG_DAY_SIZE)
+	{
+		AT24Cxx_ReadByte(RFIDLog_DayAddr(i), (uint8_t*)Entry, sizeof(Entry));
+		for (uint8_t j = 0; j < RFIDLOG_BLOCK_SIZE / RFIDLOG_DAY_SIZE; j++)
+		{
+			if (RFIDLog_DayIsValid(&Entry[j]) &&
+					(dayDate == RFIDLOG_ANY_DATE || Entry[j].seq > daySeq))
+			{
+				dayDate = Entry[j].date;
+				daySeq = Entry[j].seq;
+				dayNext = (i + j + 1) % daySlots;
+			}
+		}
+	}
+}
+
+/**
+  * @brief  Add a day index entry if the record Seq starts another day
+  * @note   A clock set back starts another day too, a date can have several
+  *         entries
+  */
+static void RFIDLog_DayNote(uint32_t Seq, uint32_t Stamp)
+{
+	uint16_t Date = RFIDRec_StampToDate(Stamp);
+	uint16_t Entry = dayNext;
+
+	if (dayDate != RFIDLOG_ANY_DATE)
+	{
+		if (Date == dayDate && daySeq <= Seq)
+		{
+			return;
+		}
+		/* The newest day has no record left (lost to a reset), its entry
+		 * is reused so sequence numbers keep growing */
+		if (daySeq >= Seq)
+		{
+			Entry = (dayNext + daySlots - 1) % daySlots;
+		}
+	}
+
+	RFIDLog_DayEntry New = {
+		.date = Date,
+		.reserved = 0,
+		.seq = Seq
+	};
+	New.crc = RFIDLog_DayChecksum(&New);
+	if (RFIDLog_Write(RFIDLog_DayAddr(Entry), (uint8_t*)&New,
+			RFIDLOG_DAY_SIZE) != 0)
+	{
+		writeErrors++;
+		return;
+	}
+	dayDate = Date;
+	daySeq = Seq;
+	dayNext = (Entry + 1) % daySlots;
+}
+
+/* UID Directory -------------------------------------------------------------*/
+static uint16_t RFIDLog_DirAddr(uint16_t Entry)
+{
+	return dirAddr + (Entry * RFIDLOG_DIR_ENTRY_SIZE);
+}
+
+/**
+  * @brief  Read a directory entry
+  * @retval Valid = 1, 0 otherwise
+  */
+static uint8_t RFIDLog_DirRead(uint16_t Entry, RFIDLog_DirEntry *e)
+{
+	AT24Cxx_ReadByte(RFIDLog_DirAddr(Entry), (uint8_t*)e,
+			RFIDLOG_DIR_ENTRY_SIZE);
+	return RFIDLog_DirIsValid(e);
+}
+
+static void RFIDLog_DirKey(RFIDLog_DirEntry *Key, const uint8_t *Uid,
+		uint8_t UidSize)
+{
+	if (UidSize > RFIDREC_UID_MAX)
+	{
+		UidSize = RFIDREC_UID_MAX;
+	}
+	memset(Key, 0, sizeof(*Key));
+	memcpy(Key->uid, Uid, UidSize);
+	Key->info = RFIDREC_INFO(0, UidSize);
+}
+
+/**
+  * @brief  Order of two directory entries by UID bytes, then UID size
+  * @retval < 0, 0 or > 0 like memcmp()
+  */
+static int RFIDLog_DirCompare(const RFIDLog_DirEntry *a,
+		const RFIDLog_DirEntry *b)
+{
+	int Diff = memcmp(a->uid, b->uid, RFIDREC_UID_MAX);
+
+	return Diff ? Diff : (int)(a->info & 0x03) - (int)(b->info & 0x03);
+}
+
+/**
+  * @brief  Binary search for a UID
+  * @retval Found = 1 (entry at *Pos read into *Found), 0 = *Pos is where it
+  *         belongs
+  */
+static uint8_t RFIDLog_DirSearch(const RFIDLog_DirEntry *Key, uint16_t *Pos,
+		RFIDLog_DirEntry *Found)
+{
+	uint16_t Lo = 0;
+	uint16_t Hi = dirCount;
+
+	/* While entries move up the one above the top may hold the last of them.
+	 * A torn entry sorts last, it can only be the one written last. */
+	if (dirMoveEnd != 0)
+	{
+		Hi++;
+	}
+	while (Lo < Hi)
+	{
+		uint16_t Mid = Lo + ((Hi - Lo) / 2);
+		int Diff = RFIDLog_DirRead(Mid, Found) ?
+				RFIDLog_DirCompare(Found, Key) : 1;
+
+		if (Diff == 0)
+		{
+			*Pos = Mid;
+			return 1;
+		}
+		if (Diff < 0)
+		{
+			Lo = Mid + 1;
+		}
+		else
+		{
+			Hi = Mid;
+		}
+	}
+
+	*Pos = Lo;
+	return 0;
+}
+
+/**
+  * @brief  Start over from the oldest record, the entries are erased first
+  *         one page per step
+  */
+static void RFIDLog_DirRestart(void)
+{
+	dirCount = 0;
+	dirFull = 0;
+	dirRebuild = 2;
+	dirVerify = 0;
+	dirSeq = 0;
+	dirErase = dayAddr;
+	dirMoveEnd = 0;
+}
+
+/**
+  * @brief  Drop every directory entry, every record of the log is entered again
+  * @retval Success = 0, Failed = 1
+  */
+static uint8_t RFIDLog_DirReset(void)
+{
+	RFIDLog_DirRestart();
+	dirErase = dirAddr;
+	return RFIDLog_Erase(dirAddr, dayAddr);
+}
+
+/**
+  * @brief  Check that the record in a slot carries the UID of an entry
+  */
+static uint8_t RFIDLog_DirMatches(const RFIDLog_DirEntry *Entry)
+{
+	RFID_Record Rec;
+
+	return RFIDLog_ReadAt(Entry->slot, &Rec) == 0 &&
+			RFIDREC_INFO_UID_SIZE(Rec.info) ==
+			RFIDREC_INFO_UID_SIZE(Entry->info) &&
+			memcmp(Rec.uid, Entry->uid, RFIDREC_UID_MAX) == 0;
+}
+
+/**
+  * @brief  Count and check the directory entries after a boot, one page per
+  *         step, then enter the records of the log again, see
+  *         RFIDLog_DirStep()
+  */
+static void RFIDLog_DirLoad(void)
+{
+	dirCount = 0;
+	dirFull = 0;
+	dirRebuild = 0;
+	dirVerify = (dirSlots != 0);
+	dirSeq = 0;
+	dirErase = dirAddr;
+	dirMoveEnd = 0;
+}
+
+/**
+  * @brief  Check the next page of entries
+  * @note   The valid entries have to be sorted and form a prefix. A write
+  *         torn by a reset breaks that, as does a directory that ran full
+  *         and may have left UIDs out: it is rebuilt.
+  */
+static void RFIDLog_DirCheck(void)
+{
+	RFIDLog_DirEntry Entry;
+	const uint16_t PerPage = AT24Cxx_PageSize() / RFIDLOG_DIR_ENTRY_SIZE;
+
+	for (uint16_t i = 0; i < PerPage; i++)
+	{
+		if (dirCount >= dirSlots)
+		{
+			RFIDLog_DirRestart();
+			return;
+		}
+		if (!RFIDLog_DirRead(dirCount, &Entry))
+		{
+			/* A torn page leaves valid entries above it */
+			for (uint16_t Next = dirCount + 1;
+					Next <= dirCount + PerPage && Next < dirSlots; Next++)
+			{
+				if (RFIDLog_DirRead(Next, &Entry))
+				{
+					RFIDLog_DirRestart();
+					return;
+				}
+			}
+			/* Entries of a torn write at the top are gone, every record
+			 * is entered again */
+			dirVerify = 0;
+			dirRebuild = 1;
+			return;
+		}
+		if (dirCount != 0 && RFIDLog_DirCompare(&Entry, &dirKey) < 0)
+		{
+			RFIDLog_DirRestart();
+			return;
+		}
+		dirKey = Entry;
+		dirCount++;
+	}
+}
+
+/**
+  * @brief  Enter one record or move one page of entries
+  * @retval Work done = 1, 0 = the directory is up to date
+  * @note   A new UID moves the entries above it up by one, the last one
+  *         first, a page per step, so a reset leaves at worst a duplicate.
+  *         If the directory is full it is rebuilt once to drop the UIDs
+  *         that left the log; still full, the UID is left out and the
+  *         directory stays incomplete.
+  */
+static uint8_t RFIDLog_DirStep(void)
+{
+	RFIDLog_DirEntry Key;
+	RFIDLog_DirEntry Entry;
+	RFID_Record Rec;
+	uint16_t Pos;
+
+	if (dirSlots == 0)
+	{
+		return 0;
+	}
+	if (dirVerify)
+	{
+		RFIDLog_DirCheck();
+		return 1;
+	}
+	if (dirErase > dirAddr)
+	{
+		uint16_t End = dirErase;
+		dirErase -= AT24Cxx_PageSize();
+		RFIDLog_Erase(dirErase, End);
+		return 1;
+	}
+	if (dirMoveEnd != 0)
+	{
+		uint8_t Chunk[AT24Cxx_PAGE_SIZE_MAX];
+		uint16_t Start = RFIDLog_DirAddr(dirMovePos);
+
+		/* Whole pages at the target, no write crosses a page */
+		uint16_t Len = (dirMoveEnd + RFIDLOG_DIR_ENTRY_SIZE) % AT24Cxx_PageSize();
+		if (Len == 0)
+		{
+			Len = AT24Cxx_PageSize();
+		}
+		if (Len > dirMoveEnd - Start)
+		{
+			Len = dirMoveEnd - Start;
+		}
+		if (Len != 0)
+		{
+			dirMoveEnd -= Len;
+			AT24Cxx_ReadByte(dirMoveEnd, Chunk, Len);
+			RFIDLog_Write(dirMoveEnd + RFIDLOG_DIR_ENTRY_SIZE, Chunk, Len);
+		}
+		if (dirMoveEnd <= Start)
+		{
+			RFIDLog_Write(Start, (uint8_t*)&dirKey, RFIDLOG_DIR_ENTRY_SIZE);
+			dirMoveEnd = 0;
+			dirCount++;
+			dirSeq++;
+		}
+		return 1;
+	}
+
+	/* Records that left the log before they were entered are skipped */
+	uint32_t First = RFIDLog_FirstSeq();
+	if (dirSeq < First)
+	{
+		dirSeq = First;
+	}
+	if (dirSeq >= RFIDLog_HeadSeq())
+	{
+		dirRebuild = 0;
+		return 0;
+	}
+
+	uint16_t Slot = (uint16_t)(dirSeq % capacity);
+	if (RFIDLog_ReadAt(Slot, &Rec) != 0)
+	{
+		dirSeq++;
+		return 1;
+	}
+	RFIDLog_DirKey(&Key, Rec.uid, RFIDREC_INFO_UID_SIZE(Rec.info));
+	Key.slot = Slot;
+	Key.crc = RFIDLog_DirChecksum(&Key);
+
+	switch (RFIDLog_DirSearch(&Key, &Pos, &Entry))
+	{
+	case 1:
+		/* Records may be entered twice after a reset, only a newer one
+		 * moves the entry */
+		if (Entry.slot != Key.slot && (!RFIDLog_DirMatches(&Entry) ||
+				RFIDLog_SlotSeq(Entry.slot) < dirSeq))
+		{
+			RFIDLog_Write(RFIDLog_DirAddr(Pos), (uint8_t*)&Key,
+					RFIDLOG_DIR_ENTRY_SIZE);
+		}
+		break;
+	case 0:
+		if (dirFull)
+		{
+			break;
+		}
+		if (dirCount >= dirSlots)
+		{
+			if (dirRebuild == 2)
+			{
+				dirFull = 1;
+				break;
+			}
+			RFIDLog_DirRestart();
+			return 1;
+		}
+		dirKey = Key;
+		dirMovePos = Pos;
+		dirMoveEnd = RFIDLog_DirAddr(dirCount);
+		return 1;
+	}
+	dirSeq++;
+
+	return 1;
+}
+
+/* Daily Summaries -----------------------------------------------------------*/
+static uint16_t RFIDLog_SumAddr(uint16_t Block)
+{
+	return sumAddr + (Block * RFIDSUM_BLOCK_SIZE);
+}
+
+/**
+  * @brief  Read a summary block
+  * @retval Valid = 1, 0 otherwise
+  */
+static uint8_t RFIDLog_SumRead(uint16_t Block, RFIDLog_SumBlock *b)
+{
+	AT24Cxx_ReadByte(RFIDLog_SumAddr(Block), (uint8_t*)b, RFIDSUM_BLOCK_SIZE);
+	return RFIDLog_SumIsValid(b);
+}
+
+/**
+  * @brief  Lap a summary block was written in
+  * @retval Lap 0..3, 0xFF if the block is not valid
+  */
+static uint8_t RFIDLog_SumLap(uint16_t Block)
+{
+	RFIDLog_SumBlock b;
+
+	return RFIDLog_SumRead(Block, &b) ? RFIDREC_INFO_LAP(b.info) : 0xFF;
+}
+
+/**
+  * @brief  Drop every daily summary
+  * @retval Success = 0, Failed = 1
+  */
+static uint8_t RFIDLog_SumReset(void)
+{
+	sumHead = 0;
+	sumLap = 0;
+	return RFIDLog_Erase(sumAddr, RFIDLog_SumAddr(sumBlocks));
+}
+
+/**
+  * @brief  Locate the next summary block by bisection over the laps
+  */
+static void RFIDLog_SumLoad(void)
+{
+	uint16_t Lo = 1;
+	uint16_t Hi = sumBlocks;
+
+	sumHead = 0;
+	sumLap = RFIDLog_SumLap(0);
+	if (sumLap == 0xFF)
+	{
+		/* Empty, or block 0 of a new lap torn: the lap after block 1's */
+		uint8_t Next = (sumBlocks > 1) ? RFIDLog_SumLap(1) : 0xFF;
+		sumLap = (Next == 0xFF) ? 0 : ((Next + 1) & 0x03);
+		return;
+	}
+
+	while (Lo < Hi)
+	{
+		uint16_t Mid = Lo + ((Hi - Lo) / 2);
+		if (RFIDLog_SumLap(Mid) == sumLap)
+		{
+			Lo = Mid + 1;
+		}
+		else
+		{
+			Hi = Mid;
+		}
+	}
+	sumHead = Lo;
+}
+
+/**
+  * @brief  Append a summary block, the oldest one is overwritten once the
+  *			ring is full
+  * @retval Success = 0, Failed = 1
+  */
+static uint8_t RFIDLog_SumWrite(RFIDLog_SumBlock *b)
+{
+	if (sumHead >= sumBlocks)
+	{
+		sumHead = 0;
+		sumLap = (sumLap + 1) & 0x03;
+	}
+	b->info = RFIDREC_INFO_WITH_LAP(RFIDSUM_VERSION << 6, sumLap);
+	b->crc = RFIDLog_SumChecksum(b);
+	if (RFIDLog_Write(RFIDLog_SumAddr(sumHead), (uint8_t*)b,
+			RFIDSUM_BLOCK_SIZE) != 0)
+	{
+		writeErrors++;
+		return 1;
+	}
+	sumHead++;
+
+	return 0;
+}
+
+/**
+  * @brief  Write an empty log, stale records must not look like current ones
+  * @retval Success = 0, Failed = 1
+  */
+static uint8_t RFIDLog_Format(void)
+{
+	uint8_t Status = RFIDLog_Erase(RFIDLOG_BASE_ADDR, RFIDLOG_RING_END);
+
+	Status |= RFIDLog_SumReset();
+	Status |= RFIDLog_DirReset();
+	Status |= RFIDLog_DayReset();
+#ifdef RFIDLOG_COMPACT
+	Status |= RFIDLog_RosterReset();
+#endif
+	RFIDLog_NewHeader();
+
+	return Status | RFIDLog_WriteHeader();
+}
+
+#ifndef RFIDLOG_COMPACT
+/**
+  * @brief  Newest valid migration state, step 0 if the conversion has not started
+  * @retval Copy to write next
+  */
+static uint8_t RFIDLog_MigrateLoad(uint16_t Addr, RFIDLog_MigrateState *State)
+{
+	RFIDLog_MigrateState Copy[RFIDLOG_MIGRATE_COPIES];
+	uint32_t Best = 0;
+	uint8_t Next = 0;
+
+	if (RFIDLog_ReadRetry(Addr, (uint8_t*)Copy, sizeof(Copy)) != 0)
+	{
+		memset(Copy, 0, sizeof(Copy));
+	}
+	memset(State, 0, sizeof(*State));
+	for (uint8_t i = 0; i < RFIDLOG_MIGRATE_COPIES; i++)
+	{
+		uint32_t Progress = ((Copy[i].step == RFIDLOG_MIGRATE_CONVERT) ?
+				0x10000UL : 0) + Copy[i].done;
+		if (RFIDLog_MigrateIsValid(&Copy[i]) && (State->step == 0 || Progress > Best))
+		{
+			*State = Copy[i];
+			Best = Progress;
+			Next = (i + 1) % RFIDLOG_MIGRATE_COPIES;
+		}
+	}
+	return Next;
+}
+
+/**
+  * @brief  Persist the migration state over the older copy
+  */
+static void RFIDLog_MigrateSave(uint16_t Addr, RFIDLog_MigrateState *State,
+		uint8_t *Copy)
+{
+	State->crc = RFIDLog_MigrateChecksum(State);
+	RFIDLog_Write(Addr + (*Copy * RFIDLOG_MIGRATE_SIZE), (uint8_t*)State,
+			RFIDLOG_MIGRATE_SIZE);
+	*Copy = (*Copy + 1) % RFIDLOG_MIGRATE_COPIES;
+}
+
+/**
+  * @brief  Convert a log in the legacy 12 byte layout to 16 byte records
+  * @note   Every step is recorded in the migration state once its write has
+  *         completed, a reset resumes at the step that was in flight.
+  * @retval Number of records kept
+  * @param  Count	Legacy record counter
+  * @param  Layout	Layout of the log being created
+  */
+static uint16_t RFIDLog_Migrate(uint16_t Count, const RFIDLog_Layout *Layout)
+{
+	RFIDLog_MigrateState State;
+	RFID_LegacyLog Old;
+	RFID_Record Page[RFIDLOG_BLOCK_SLOTS];
+	const uint16_t PerPage = RFIDLOG_BLOCK_SLOTS;
+	const uint16_t StateAddr = RFIDLog_MigrateAddr(Layout, Count);
+	uint8_t Copy = RFIDLog_MigrateLoad(StateAddr, &State);
+
+	/* Too many records for the bigger format: drop the oldest ones by moving
+	 * the rest down to the second legacy slot, the first holds the state.
+	 * The target is always below and a chunk never overlaps its own source,
+	 * so the chunk in flight at a reset can be copied again. */
+	uint16_t First = 0;
+	if (Count > capacity)
+	{
+		const uint16_t Dst = RFIDLOG_LEGACY_BASE_ADDR + RFIDLOG_LEGACY_SIZE;
+		const uint16_t Gap = (Count - capacity - 1) * RFIDLOG_LEGACY_SIZE;
+		const uint16_t Total = capacity * RFIDLOG_LEGACY_SIZE;
+
+		if (State.step == 0)
+		{
+			State.step = RFIDLOG_MIGRATE_SHIFT;
+			State.done = 0;
+		}
+		while (Gap && State.step == RFIDLOG_MIGRATE_SHIFT && State.done < Total)
+		{
+			uint8_t Chunk[AT24Cxx_PAGE_SIZE_MAX];
+			uint16_t To = Dst + State.done;
+			uint16_t Len = AT24Cxx_PageSize() - (To % AT24Cxx_PageSize());
+			if (Len > Gap)
+			{
+				Len = Gap;
+			}
+			if (Len > Total - State.done)
+			{
+				Len = Total - State.done;
+			}
+			AT24Cxx_ReadByte(To + Gap, Chunk, Len);
+			RFIDLog_Write(To, Chunk, Len);
+			State.done += Len;
+			RFIDLog_MigrateSave(StateAddr, &State, &Copy);
+		}
+		Count = capacity;
+		First = 1;
+	}
+
+	/* Convert one page at a time, from the end towards the start. A new page
+	 * only overlaps legacy records that have been converted already. */
+	const uint16_t Pages = (Count + PerPage - 1) / PerPage;
+	if (State.step != RFIDLOG_MIGRATE_CONVERT)
+	{
+		State.step = RFIDLOG_MIGRATE_CONVERT;
+		State.done = 0;
+		RFIDLog_MigrateSave(StateAddr, &State, &Copy);
+	}
+	while (State.done < Pages)
+	{
+		uint16_t Block = Pages - 1 - State.done;
+		memset(Page, 0xFF, sizeof(Page));
+		for (uint16_t i = 0; i < PerPage; i++)
+		{
+			uint16_t Index = (Block * PerPage) + i;
+			if (Index >= Count)
+			{
+				break;
+			}
+			AT24Cxx_ReadByte(RFIDLOG_LEGACY_BASE_ADDR +
+					((First + Index) * RFIDLOG_LEGACY_SIZE), (uint8_t*)&Old,
+					RFIDLOG_LEGACY_SIZE);
+			RFIDLog_MakeRecord(&Page[i], Old.uid, 4, Old.status,
+					RFIDREC_STAMP(Old.year, Old.month, Old.day, Old.hour,
+							Old.minute, Old.second));
+		}
+		RFIDLog_Write(RFIDLOG_BASE_ADDR + (Block * RFIDLOG_BLOCK_SIZE),
+				(uint8_t*)Page, RFIDLOG_BLOCK_SIZE);
+		State.done++;
+		RFIDLog_MigrateSave(StateAddr, &State, &Copy);
+	}
+
+	/* Leftovers of the legacy log must not look like records of pass 0.
+	 * The header goes to copy 1, the legacy counter in copy 0 stays
+	 * readable until a valid header exists. A state at the end of the log
+	 * is erased with the day index after that; one in the first legacy
+	 * slot goes with the next write of header copy 0. */
+	RFIDLog_Erase(RFIDLOG_BASE_ADDR + (Pages * RFIDLOG_BLOCK_SIZE),
+			RFIDLOG_RING_END);
+	RFIDLog_SumReset();
+	RFIDLog_NewHeader();
+	RFIDLog_WriteHeader();
+	RFIDLog_DayReset();
+
+	return Count;
+}
+#endif
+
+/**
+  * @brief  First ring slot at or above EEPROM address Addr
+  */
+static uint16_t RFIDLog_SlotAt(uint16_t Addr)
+{
+	uint32_t Slot = 0;
+
+	if (Addr > RFIDLOG_BASE_ADDR)
+	{
+		Slot = ((uint32_t)(Addr - RFIDLOG_BASE_ADDR + RFIDLOG_BLOCK_SIZE - 1) /
+				RFIDLOG_BLOCK_SIZE) * RFIDLOG_BLOCK_SLOTS;
+	}
+	return (Slot < capacity) ? (uint16_t)Slot : capacity;
+}
+
+/**
+  * @brief  Repair pages torn by a reset during their write-back
+  * @note   Bisection assumes that the current pass is a prefix of the ring.
+  *         Only the page writes still in flight can break that, one per
+  *         striped device on consecutive pages: the head moves back to the
+  *         first bad slot among them and the rest is erased, so no stray
+  *         current record remains above the head.
+  * @retval Success = 0, Failed = 1: a slot could not be read, nothing is
+  *         erased
+  */
+static uint8_t RFIDLog_Recover(void)
+{
+	const uint16_t Page = AT24Cxx_PageSize();
+	const uint16_t Span = Page * (AT24Cxx_DEV_NUM - 1);	// Other stripes
+	uint16_t Last = (head == 0) ? RFIDLOG_BASE_ADDR : RFIDLog_SlotAddr(head - 1);
+	Last -= Last % Page;
+	uint16_t Slot = RFIDLog_SlotAt((Last > Span) ? Last - Span : 0);
+	uint8_t Torn = 0;
+
+	for (; Slot < head; Slot++)
+	{
+		uint8_t Lap = RFIDLog_SlotLap(Slot);
+
+		if (Lap == RFIDLOG_LAP_FAILED)
+		{
+			return 1;
+		}
+		if (Lap != (hdr.pass & 0x03))
+		{
+			head = Slot;
+			Torn = 1;
+		}
+	}
+
+	uint16_t Next = RFIDLog_SlotAddr(head);
+	uint16_t End = RFIDLog_SlotAt(Next - (Next % Page) + Page + Span);
+	/* A compact event left above the head becomes current again as soon
+	 * as a new base is written, whether its own base is intact or not */
+	for (Slot = head; Slot < End && !Torn; Slot++)
+	{
+		uint8_t Lap = RFIDLog_DataLap(Slot);
+
+		if (Lap == RFIDLOG_LAP_FAILED)
+		{
+			return 1;
+		}
+		Torn = (Lap == (hdr.pass & 0x03));
+	}
+	if (!Torn)
+	{
+		return 0;
+	}
+
+	RFIDLog_Erase(RFIDLog_SlotStart(head), RFIDLog_SlotAddr(End - 1) +
+			RFIDLOG_SLOT_SIZE);
+	recovered++;
+
+	/* The erased slots above the head held the oldest records */
+	if (hdr.pass > 0)
+	{
+		uint32_t Oldest = ((uint32_t)(hdr.pass - 1) * capacity) + End;
+		if (hdr.start < Oldest)
+		{
+			hdr.start = Oldest;
+			RFIDLog_WriteHeader();
+		}
+	}
+	return 0;
+}
+
+/**
+  * @brief  Load the log header and locate the head, must be called before
+  *         any other call
+  * @retval Success = 0, Failed = 1: the header or the ring head could not
+  *         be read or the EEPROM size not probed, nothing was written; call
+  *         it again before using the log
+  */
+uint8_t RFIDLog_Init(void)
+{
+	uint8_t Status = RFIDLog_LoadHeader();
+	uint8_t Found = (Status == 0);
+	uint8_t Restripe = 0;
+	RFIDLog_Layout Layout;
+
+	/* A log that cannot be read is neither formatted nor converted */
+	if (Status == 2)
+	{
+		return 1;
+	}
+	RFIDLog_CacheReset();
+
+	/* Records of a log striped over another number of devices are out of
+	 * place, the log is formatted */
+	if (Found && hdr.geometry != 0 &&
+			RFIDLOG_GEOMETRY_DEVICES(hdr.geometry) != AT24Cxx_DEV_NUM)
+	{
+		Found = 0;
+		Restripe = 1;
+	}
+
+	/* The size is probed once, the probe toggles a byte of header copy 0.
+	 * Without a size the layout is unknown: nothing is formatted or
+	 * written, the geometry stays unset and the next boot probes again. */
+	if (Found && hdr.geometry != 0)
+	{
+		AT24Cxx_SetSize(1UL << RFIDLOG_GEOMETRY_BITS(hdr.geometry));
+	}
+	else
+	{
+		uint8_t Tries = 0;
+
+		while (AT24Cxx_Detect(RFIDLOG_PROBE_ADDR) != 0)
+		{
+			if (++Tries == RFIDLOG_READ_RETRIES)
+			{
+				return 1;
+			}
+		}
+	}
+	RFIDLog_MakeLayout(&Layout, AT24Cxx_Size(), AT24Cxx_PageSize(),
+			RFIDLOG_THIS_LAYOUT == RFIDLOG_LAYOUT_COMPACT);
+	endAddr = Layout.endAddr;
+#ifdef RFIDLOG_COMPACT
+	rosterSize = Layout.rosterSize;
+	rosterAddr = Layout.rosterAddr;
+#endif
+	daySlots = Layout.daySlots;
+	dayAddr = Layout.dayAddr;
+	dirSlots = Layout.dirSlots;
+	dirAddr = Layout.dirAddr;
+	sumBlocks = Layout.sumBlocks;
+	sumAddr = Layout.sumAddr;
+	capacity = Layout.capacity;
+	stageLen = 0;
+	stageAddr = endAddr;
+
+	if (Found)
+	{
+		/* Slot 0 already in the next pass: only an older header copy
+		 * survived, catch up with the ring */
+		uint8_t Lap = RFIDLog_SlotLap(0);
+		if (Lap == RFIDLOG_LAP_FAILED)
+		{
+			return 1;
+		}
+		if (Lap == ((hdr.pass + 1) & 0x03))
+		{
+			hdr.pass++;
+		}
+		if (RFIDLog_FindHead() != 0 || RFIDLog_Recover() != 0)
+		{
+			return 1;
+		}
+		if (hdr.geometry == 0)
+		{
+			hdr.geometry = RFIDLog_Geometry();
+			RFIDLog_WriteHeader();
+		}
+		RFIDLog_DayLoad();
+		RFIDLog_SumLoad();
+#ifdef RFIDLOG_COMPACT
+		RFIDLog_RosterLoad();
+#endif
+		RFIDLog_DirLoad();
+	}
+	else
+	{
+		/* A restriped header stays valid, its successor must be newer */
+		if (!Restripe)
+		{
+			hdr.update = 0;
+		}
+		head = 0;
+#ifndef RFIDLOG_COMPACT
+		/* Legacy layout: 2 byte counter at 0x0000 */
+		uint16_t Legacy = (uint16_t)hdr.magic;
+		if (!Restripe && Legacy != 0xFFFF && Legacy != 0 &&
+				RFIDLOG_LEGACY_BASE_ADDR +
+				((uint32_t)Legacy * RFIDLOG_LEGACY_SIZE) <= endAddr)
+		{
+			head = RFIDLog_Migrate(Legacy, &Layout);
+			RFIDLog_DirReset();
+		}
+		else
+#endif
+		{
+			RFIDLog_Format();
+		}
+	}
+
+	stageAddr = RFIDLog_SlotStart(head);
+#ifdef RFIDLOG_COMPACT
+	if (head % RFIDLOG_BLOCK_SLOTS)
+	{
+		blockSeconds = RFIDLog_BlockSeconds();
+	}
+#endif
+	rollFrom = (uint32_t)-1;	// No roll-up state, the next one starts afresh
+
+	return 0;
+}
+
+/**
+  * @brief  Decode the record in a ring slot from a copy of its block
+  * @retval Success = 0, Failed = 1 (CRC mismatch), 2 = filler slot
+  * @param  Block	The RFIDLOG_BLOCK_SIZE bytes at RFIDLog_BlockAddr(Slot)
+  */
+static uint8_t RFIDLog_DecodeBlock(const uint8_t *Block, uint16_t Slot,
+		RFID_Record *rec)
+{
+#ifdef RFIDLOG_COMPACT
+	RFID_CompactBase Base;
+	uint32_t Event = 0;
+	uint32_t Sec;
+	uint16_t First = Slot - (Slot % RFIDLOG_BLOCK_SLOTS);
+
+	memcpy(&Base, Block, RFIDCMP_BASE_SIZE);
+	if (!RFIDCmp_BaseIsValid(&Base))
+	{
+		return 1;
+	}
+
+	/* Deltas chain from the base through every event up to this one */
+	Sec = RFIDRec_StampToSeconds(Base.stamp);
+	for (uint16_t i = First; i <= Slot; i++)
+	{
+		memcpy(&Event, &Block[RFIDCMP_BASE_SIZE + ((i - First) *
+				RFIDLOG_SLOT_SIZE)], RFIDLOG_SLOT_SIZE);
+		if (!RFIDCmp_EventIsValid(Event))
+		{
+			return 1;
+		}
+		Sec += RFIDCMP_EVENT_DELTA(Event);
+	}
+
+	uint16_t Roster = RFIDCMP_EVENT_ROSTER(Event);
+	if (Roster == RFIDCMP_ROSTER_VOID)
+	{
+		return 2;
+	}
+	if (Roster >= rosterCount)
+	{
+		return 1;
+	}
+	RFID_Record Entry;
+	RFIDLog_CacheRead(RFIDLog_RosterAddr(Roster), (uint8_t*)&Entry,
+			RFIDREC_SIZE);
+	if (!RFIDRec_IsValid(&Entry))
+	{
+		return 1;
+	}
+	RFIDLog_MakeRecord(rec, Entry.uid, RFIDREC_INFO_UID_SIZE(Entry.info),
+			RFIDCMP_EVENT_STATUS(Event), RFIDRec_SecondsToStamp(Sec));
+
+	return 0;
+#else
+	memcpy(rec, &Block[(Slot % RFIDLOG_BLOCK_SLOTS) * RFIDREC_SIZE],
+			RFIDREC_SIZE);
+
+	return !RFIDRec_IsValid(rec);
+#endif
+}
+
+/**
+  * @brief  Decode the record in a ring slot
+  * @retval Success = 0, Failed = 1 (CRC mismatch), 2 = filler slot
+  */
+static uint8_t RFIDLog_Decode(uint16_t Slot, RFID_Record *rec)
+{
+#ifdef RFIDLOG_COMPACT
+	uint8_t Block[RFIDLOG_BLOCK_SIZE];
+
+	RFIDLog_ReadRaw(RFIDLog_BlockAddr(Slot), Block, RFIDLOG_BLOCK_SIZE, 1);
+
+	return RFIDLog_DecodeBlock(Block, Slot, rec);
+#else
+	RFIDLog_ReadRaw(RFIDLog_SlotAddr(Slot), (uint8_t*)rec, RFIDREC_SIZE, 1);
+
+	return !RFIDRec_IsValid(rec);
+#endif
+}
+
+uint16_t RFIDLog_Count(void)
+{
+	return (uint16_t)(RFIDLog_HeadSeq() - RFIDLog_FirstSeq());
+}
+
+uint16_t RFIDLog_Capacity(void)
+{
+	return capacity;
+}
+
+/**
+  * @brief  Ring slot of a record, stable until the record is evicted
+  * @param  index	Log index, 0 = oldest record
+  */
+uint16_t RFIDLog_Slot(uint16_t index)
+{
+	return (uint16_t)((RFIDLog_FirstSeq() + index) % capacity);
+}
+
+/**
+  * @brief  Read one record, staged records are served from RAM
+  * @retval Success = 0, Failed = 1 (index out of range or CRC mismatch),
+  *         2 = filler slot
+  * @param  index	Log index, 0 = oldest record
+  */
+uint8_t RFIDLog_Read(uint16_t index, RFID_Record *rec)
+{
+	if (index >= RFIDLog_Count())
+	{
+		return 1;
+	}
+
+	uint16_t Slot = RFIDLog_Slot(index);
+	uint8_t Status = RFIDLog_Decode(Slot, rec);
+
+	/* Browsing moves one record at a time, fetch ahead in that direction */
+	RFIDLog_Prefetch(RFIDLog_BlockAddr(Slot), index >= lastIndex);
+	lastIndex = index;
+
+	return Status;
+}
+
+/**
+  * @brief  Read the record in a ring slot
+  * @retval Success = 0, Failed = 1 (slot not in the log or CRC mismatch),
+  *         2 = filler slot
+  */
+uint8_t RFIDLog_ReadAt(uint16_t slot, RFID_Record *rec)
+{
+	if (slot >= capacity)
+	{
+		return 1;
+	}
+
+	uint32_t Seq = RFIDLog_SlotSeq(slot);
+	if (Seq >= RFIDLog_HeadSeq() || Seq < RFIDLog_FirstSeq())
+	{
+		return 1;
+	}
+
+	return RFIDLog_Decode(slot, rec);
+}
+
+/**
+  * @brief  Start a scan over the sequence numbers From up to End
+  */
+static void RFIDLog_Range(RFIDLog_Iter *it, uint32_t From, uint32_t End)
+{
+	it->seq = From;
+	it->end = End;
+	it->slot = 0;
+	it->date = RFIDLOG_ANY_DATE;
+	it->bufAddr = 0;
+	it->bufLen = 0;
+}
+
+/**
+  * @brief  Start a scan over the log, oldest record first
+  * @note   Records appended during the scan are not part of it
+  */
+void RFIDLog_Begin(RFIDLog_Iter *it)
+{
+	RFIDLog_Range(it, RFIDLog_FirstSeq(), RFIDLog_HeadSeq());
+}
+
+/**
+  * @brief  Read day index entry i of a scan through the index
+  * @retval Valid = 1, 0 otherwise
+  * @note   Entries are read in bursts into it->buf
+  */
+static uint8_t RFIDLog_DayEntryAt(RFIDLog_Iter *it, uint16_t i,
+		RFIDLog_DayEntry *Entry)
+{
+	const uint16_t PerBurst = RFIDLOG_ITER_SIZE / RFIDLOG_DAY_SIZE;
+
+	if ((i % PerBurst) == 0)
+	{
+		uint16_t Len = (daySlots - i) * RFIDLOG_DAY_SIZE;
+		AT24Cxx_ReadByte(RFIDLog_DayAddr(i), it->buf,
+				(Len < RFIDLOG_ITER_SIZE) ? Len : RFIDLOG_ITER_SIZE);
+	}
+	memcpy(Entry, &it->buf[(i % PerBurst) * RFIDLOG_DAY_SIZE],
+			RFIDLOG_DAY_SIZE);
+
+	return RFIDLog_DayIsValid(Entry);
+}
+
+/**
+  * @brief  Start a scan over the records of one day, oldest first
+  * @retval 0 = range taken from the day index, 1 = the day has no entry and
+  *			the records older than the index are scanned for it
+  * @param  stamp	Any RFIDREC_STAMP() of the day
+  */
+uint8_t RFIDLog_BeginDay(RFIDLog_Iter *it, uint32_t stamp)
+{
+	RFIDLog_DayEntry Entry;
+	uint16_t Date = RFIDRec_StampToDate(stamp);
+	uint32_t First = RFIDLog_FirstSeq();
+	uint32_t Oldest = RFIDLog_HeadSeq();
+	uint32_t From = RFIDLog_HeadSeq();
+	uint32_t Last = 0;
+	uint32_t End = RFIDLog_HeadSeq();
+	uint8_t Found = 0;
+
+	/* The day runs from its first entry up to the entry that follows its
+	 * last one, other days in between (clock set back) are skipped by
+	 * RFIDLog_Next() */
+	for (uint16_t i = 0; i < daySlots; i++)
+	{
+		if (!RFIDLog_DayEntryAt(it, i, &Entry))
+		{
+			continue;
+		}
+		if (Entry.seq < Oldest)
+		{
+			Oldest = Entry.seq;
+		}
+		if (Entry.date == Date)
+		{
+			From = (Entry.seq < From) ? Entry.seq : From;
+			Last = (Entry.seq > Last) ? Entry.seq : Last;
+			Found = 1;
+		}
+	}
+	for (uint16_t i = 0; i < daySlots && Found; i++)
+	{
+		if (RFIDLog_DayEntryAt(it, i, &Entry) && Entry.seq > Last &&
+				Entry.seq < End)
+		{
+			End = Entry.seq;
+		}
+	}
+
+	/* A day without entry can only have records older than the index */
+	if (!Found)
+	{
+		From = First;
+		End = Oldest;
+	}
+	RFIDLog_Range(it, From, End);
+	it->date = Date;
+
+	return !Found && First < Oldest;
+}
+
+/**
+  * @brief  Next slot of a scan, the EEPROM is read in bursts of up to
+  *			RFIDLOG_ITER_SIZE bytes
+  * @retval Like RFIDLog_Read(), RFIDLOG_ITER_END after the last slot
+  */
+static uint8_t RFIDLog_NextSlot(RFIDLog_Iter *it, RFID_Record *rec)
+{
+	/* Records evicted since the scan started are skipped */
+	uint32_t First = RFIDLog_FirstSeq();
+	if (it->seq < First)
+	{
+		it->seq = First;
+		it->bufLen = 0;
+	}
+	if (it->seq >= it->end)
+	{
+		return RFIDLOG_ITER_END;
+	}
+
+	uint16_t Slot = (uint16_t)(it->seq % capacity);
+	uint16_t Addr = RFIDLog_BlockAddr(Slot);
+
+	if (Addr < it->bufAddr ||
+			Addr + RFIDLOG_BLOCK_SIZE > it->bufAddr + it->bufLen)
+	{
+		/* Whole blocks from this one on, as far as the scan and the ring
+		 * go. Staged bytes are served from RAM. */
+		uint32_t Need = (Slot % RFIDLOG_BLOCK_SLOTS) + (it->end - it->seq);
+		Need = ((Need + RFIDLOG_BLOCK_SLOTS - 1) / RFIDLOG_BLOCK_SLOTS) *
+				RFIDLOG_BLOCK_SIZE;
+		if (Need > (uint32_t)(RFIDLOG_RING_END - Addr))
+		{
+			Need = RFIDLOG_RING_END - Addr;
+		}
+		it->bufAddr = Addr;
+		it->bufLen = (Need < RFIDLOG_ITER_SIZE) ? Need : RFIDLOG_ITER_SIZE;
+		RFIDLog_ReadRaw(Addr, it->buf, it->bufLen, 0);
+	}
+
+	it->slot = Slot;
+	it->seq++;
+
+	return RFIDLog_DecodeBlock(&it->buf[Addr - it->bufAddr], Slot, rec);
+}
+
+/**
+  * @brief  Next record of a scan
+  * @retval Like RFIDLog_Read(), RFIDLOG_ITER_END after the last record.
+  *			it->slot is the ring slot of the record.
+  */
+uint8_t RFIDLog_Next(RFIDLog_Iter *it, RFID_Record *rec)
+{
+	uint8_t Status;
+
+	/* A day scan skips filler and records of other days (clock set back) */
+	do
+	{
+		Status = RFIDLog_NextSlot(it, rec);
+	} while (it->date != RFIDLOG_ANY_DATE && (Status == 2 || (Status == 0 &&
+			RFIDRec_StampToDate(rec->stamp) != it->date)));
+
+	return Status;
+}
+
+/**
+  * @brief  Fill in a record and its checksum
+  * @param  uidSize	4, 7 or 10 byte
+  * @param  stamp	RFIDREC_STAMP() of the event
+  */
+void RFIDLog_MakeRecord(RFID_Record *rec, const uint8_t *uid, uint8_t uidSize,
+		uint8_t status, uint32_t stamp)
+{
+	if (uidSize > RFIDREC_UID_MAX)
+	{
+		uidSize = RFIDREC_UID_MAX;
+	}
+
+	memset(rec->uid, 0, RFIDREC_UID_MAX);
+	memcpy(rec->uid, uid, uidSize);
+	rec->info = RFIDREC_INFO(status, uidSize);
+	rec->stamp = stamp;
+	rec->crc = RFIDRec_Checksum(rec);
+}
+
+/**
+  * @brief  Report the records [From, End) leaving the log to the evict handler
+  */
+static void RFIDLog_Report(uint32_t From, uint32_t End)
+{
+	RFIDLog_Iter It;
+	RFID_Record Old;
+	uint8_t Status;
+
+	if (evictHandler == NULL)
+	{
+		return;
+	}
+	RFIDLog_Range(&It, From, End);
+	while ((Status = RFIDLog_Next(&It, &Old)) != RFIDLOG_ITER_END)
+	{
+		if (Status == 0)
+		{
+			evictHandler(It.slot, &Old);
+		}
+	}
+}
+
+/* Roll-up -------------------------------------------------------------------*/
+/* Ring slots kept free by rolling up */
+static uint16_t RFIDLog_Reserve(void)
+{
+	uint16_t Reserve = capacity / RFIDLOG_ROLLUP_FREE;
+
+	return (Reserve > RFIDLOG_EVICT_SLOTS) ? Reserve : RFIDLOG_EVICT_SLOTS;
+}
+
+/* Order of a record's UID against a roll-up entry: padded bytes, then size */
+static int RFIDLog_RollCompare(const RFID_Record *Rec,
+		const RFIDLog_RollEntry *Entry)
+{
+	int Diff = memcmp(Rec->uid, Entry->uid, RFIDREC_UID_MAX);
+
+	return Diff ? Diff : (int)RFIDREC_INFO_UID_SIZE(Rec->info) - Entry->size;
+}
+
+/* Forget the roll-up state, the next roll-up starts at the log start */
+static void RFIDLog_RollReset(void)
+{
+	rollActive = 0;
+	rollCount = 0;
+	rollFrom = RFIDLog_FirstSeq();
+	rollSeq = rollFrom;
+	rollScan = rollFrom;
+	rollScanDate = RFIDLOG_ANY_DATE;
+}
+
+/**
+  * @brief  Add a record to the batch
+  * @retval Added = 0, 1 = the batch must be written first (other date, no
+  *			room for its UID or RFIDLOG_ROLLUP_SPAN records summarised)
+  */
+static uint8_t RFIDLog_RollAdd(const RFID_Record *Rec)
+{
+	uint16_t Date = RFIDRec_StampToDate(Rec->stamp);
+	uint16_t Minute = (RFIDREC_HOUR(Rec->stamp) * 60) +
+			RFIDREC_MINUTE(Rec->stamp);
+	uint8_t Pos = 0;
+	int Diff = 1;
+
+	if (rollCount > 0 && (Date != rollDate ||
+			rollSeq - rollFrom >= RFIDLOG_ROLLUP_SPAN))
+	{
+		return 1;
+	}
+	while (Pos < rollCount &&
+			(Diff = RFIDLog_RollCompare(Rec, &rollBatch[Pos])) > 0)
+	{
+		Pos++;
+	}
+	if (Pos < rollCount && Diff == 0)
+	{
+		if (Minute < rollBatch[Pos].first) rollBatch[Pos].first = Minute;
+		if (Minute > rollBatch[Pos].last) rollBatch[Pos].last = Minute;
+		return 0;
+	}
+	if (rollCount == RFIDLOG_ROLLUP_BATCH)
+	{
+		return 1;
+	}
+
+	memmove(&rollBatch[Pos + 1], &rollBatch[Pos],
+			(rollCount - Pos) * sizeof(rollBatch[0]));
+	memcpy(rollBatch[Pos].uid, Rec->uid, RFIDREC_UID_MAX);
+	rollBatch[Pos].size = RFIDREC_INFO_UID_SIZE(Rec->info);
+	rollBatch[Pos].first = Minute;
+	rollBatch[Pos].last = Minute;
+	rollDate = Date;
+	rollCount++;
+
+	return 0;
+}
+
+/**
+  * @brief  Write the batch as summaries and move the log start past the
+  *			records it holds, [rollFrom, rollSeq)
+  * @retval Success = 0, Failed = 1: the records stay in the log, the
+  *			roll-up starts over from the log start
+  */
+static uint8_t RFIDLog_RollFlush(void)
+{
+	for (uint8_t i = 0; i < rollCount; i += RFIDSUM_ENTRIES)
+	{
+		RFIDLog_SumBlock Block;
+
+		memset(&Block, 0xFF, sizeof(Block));
+		Block.date = rollDate;
+		for (uint8_t j = 0; j < RFIDSUM_ENTRIES && i + j < rollCount; j++)
+		{
+			memcpy(Block.entry[j].uid, rollBatch[i + j].uid, RFIDREC_UID_MAX);
+			Block.entry[j].first = RFIDSUM_FIRST(rollBatch[i + j].size,
+					rollBatch[i + j].first);
+			Block.entry[j].last = rollBatch[i + j].last;
+		}
+		if (RFIDLog_SumWrite(&Block) != 0)
+		{
+			RFIDLog_RollReset();
+			return 1;
+		}
+	}
+
+	/* The header must not point past records that are still staged */
+	if (RFIDLog_Sync() != 0)
+	{
+		RFIDLog_RollReset();
+		return 1;
+	}
+	if (rollSeq > hdr.start)
+	{
+		RFIDLog_Report(rollFrom, rollSeq);
+		hdr.start = rollSeq;
+		if (RFIDLog_WriteHeader() != 0)
+		{
+			writeErrors++;
+		}
+	}
+	rollCount = 0;
+	rollFrom = RFIDLog_FirstSeq();
+	if (rollSeq < rollFrom)
+	{
+		rollSeq = rollFrom;
+	}
+	if (rollSeq >= rollEnd)
+	{
+		rollActive = 0;
+	}
+	/* The search for the end of the oldest day went past what is left */
+	if (rollScan < rollSeq)
+	{
+		rollScan = rollSeq;
+		rollScanDate = RFIDLOG_ANY_DATE;
+	}
+	return 0;
+}
+
+/**
+  * @brief  Summarise up to Budget records of the roll-up below End, write
+  *			the batch once it is full or End is reached
+  * @retval Success = 0, Failed = 1
+  * @note   One pass over the records: a UID that finds the batch full
+  *			gets a new entry of the same date in the next batch
+  */
+static uint8_t RFIDLog_RollStep(uint32_t End, uint16_t Budget)
+{
+	RFIDLog_Iter It;
+	RFID_Record Rec;
+	uint8_t Status;
+
+	if (End > rollEnd)
+	{
+		End = rollEnd;
+	}
+	RFIDLog_Range(&It, rollSeq, End);
+	while (Budget > 0 && (Status = RFIDLog_Next(&It, &Rec)) != RFIDLOG_ITER_END)
+	{
+		Budget--;
+		if (Status == 0 && RFIDLog_RollAdd(&Rec) != 0)
+		{
+			return RFIDLog_RollFlush();
+		}
+		rollSeq = It.seq;
+	}
+	if (rollSeq >= End)
+	{
+		return RFIDLog_RollFlush();
+	}
+	return 0;
+}
+
+/**
+  * @brief  Look for the end of the oldest day, RFIDLOG_ROLLUP_STEP records
+  *			at a time; start its roll-up once a later record shows up
+  * @note   A ring that is running out of reserve rolls the oldest records
+  *			up even of a day still running, so appends do not have to
+  */
+static void RFIDLog_RollFind(void)
+{
+	RFIDLog_Iter It;
+	RFID_Record Rec;
+	uint8_t Status;
+	uint16_t Budget = RFIDLOG_ROLLUP_STEP;
+
+	RFIDLog_Range(&It, rollScan, RFIDLog_HeadSeq());
+	while (Budget > 0 && (Status = RFIDLog_Next(&It, &Rec)) != RFIDLOG_ITER_END)
+	{
+		Budget--;
+		rollScan = It.seq;
+		if (Status != 0)
+		{
+			continue;
+		}
+		uint16_t Date = RFIDRec_StampToDate(Rec.stamp);
+		if (rollScanDate == RFIDLOG_ANY_DATE)
+		{
+			rollScanDate = Date;
+		}
+		else if (Date != rollScanDate)
+		{
+			rollEnd = It.seq - 1;
+			rollActive = 1;
+			rollScan = rollEnd;
+			rollScanDate = RFIDLOG_ANY_DATE;
+			return;
+		}
+	}
+
+	if (rollScan >= RFIDLog_HeadSeq() &&
+			RFIDLog_Count() + (RFIDLog_Reserve() / 2) > capacity)
+	{
+		rollEnd = RFIDLog_FirstSeq() + (RFIDLog_Reserve() / 2);
+		if (rollEnd > RFIDLog_HeadSeq())
+		{
+			rollEnd = RFIDLog_HeadSeq();
+		}
+		rollActive = 1;
+	}
+}
+
+/**
+  * @brief  Run one bounded step of the roll-up of the oldest completed day:
+  *			RFIDLOG_ROLLUP_STEP records and at most one batch written
+  * @note   A reset in between repeats the roll-up from the log start: the
+  *			summaries written so far show up twice with the same times
+  */
+static void RFIDLog_Rollup(void)
+{
+	/* The log start moved meanwhile, the batch no longer applies */
+	if (RFIDLog_FirstSeq() != rollFrom)
+	{
+		RFIDLog_RollReset();
+	}
+	if (!rollActive)
+	{
+		RFIDLog_RollFind();
+		return;
+	}
+	RFIDLog_RollStep(rollEnd, RFIDLOG_ROLLUP_STEP);
+}
+
+/**
+  * @brief  Roll up and report the records that moving the head to HeadSeq
+  *			overwrites
+  * @note   Summarises one batch, RFIDLOG_ROLLUP_SPAN records at most, or
+  *			the overwritten records if they are more; normally
+  *			RFIDLog_Maintain() keeps the reserve free and this does nothing
+  */
+static void RFIDLog_Evict(uint32_t HeadSeq)
+{
+	uint32_t End = RFIDLog_FirstSeqAt(HeadSeq);
+
+	/* Only records below the head are lost, a start ahead of it is not */
+	if (End > RFIDLog_HeadSeq())
+	{
+		End = RFIDLog_HeadSeq();
+	}
+	if (End > RFIDLog_FirstSeq())
+	{
+		/* A batch per append would fill the summaries with single entries,
+		 * take up to a span of records while at it */
+		uint32_t Limit = RFIDLog_FirstSeq() + RFIDLOG_ROLLUP_SPAN;
+
+		if (Limit < End)
+		{
+			Limit = End;
+		}
+		if (Limit > RFIDLog_HeadSeq())
+		{
+			Limit = RFIDLog_HeadSeq();
+		}
+		if (RFIDLog_FirstSeq() != rollFrom)
+		{
+			RFIDLog_RollReset();
+		}
+		if (!rollActive || rollEnd < Limit)
+		{
+			rollEnd = Limit;
+			rollActive = 1;
+		}
+		while (End > RFIDLog_FirstSeq())
+		{
+			if (RFIDLog_RollStep(Limit, 0xFFFF) != 0)
+			{
+				break;			// Summary not written, the records still go
+			}
+		}
+	}
+	RFIDLog_Report(RFIDLog_FirstSeq(), RFIDLog_FirstSeqAt(HeadSeq));
+}
+
+/**
+  * @brief  Start a scan over the daily summaries of a date range, oldest
+  *			first
+  * @param  from	Any RFIDREC_STAMP() of the first day
+  * @param  to		Any RFIDREC_STAMP() of the last day
+  * @note   The first block of the range is found by bisection over the
+  *			dates, a month costs a few reads plus its own blocks
+  */
+void RFIDLog_BeginSummary(RFIDLog_SumIter *it, uint32_t from, uint32_t to)
+{
+	RFIDLog_SumBlock Block;
+	uint16_t From = RFIDRec_StampToDate(from);
+	uint16_t Lo = 0;
+	uint16_t Hi;
+
+	/* Blocks above the head are of the previous lap once the ring wrapped,
+	 * the one right above may be torn */
+	it->oldest = 0;
+	it->count = sumHead;
+	if (sumHead < sumBlocks && (RFIDLog_SumRead(sumHead, &Block) ||
+			(sumHead + 1 < sumBlocks && RFIDLog_SumRead(sumHead + 1, &Block))))
+	{
+		it->oldest = sumHead;
+		it->count = sumBlocks;
+	}
+
+	Hi = it->count;
+	while (Lo < Hi)
+	{
+		uint16_t Mid = Lo + ((Hi - Lo) / 2);
+		if (!RFIDLog_SumRead((it->oldest + Mid) % sumBlocks, &Block) ||
+				Block.date < From)
+		{
+			Lo = Mid + 1;
+		}
+		else
+		{
+			Hi = Mid;
+		}
+	}
+
+	it->pos = Lo;
+	it->to = RFIDRec_StampToDate(to);
+	it->bufPos = 0;
+	it->bufBlocks = 0;
+	it->entry = 0;
+}
+
+/**
+  * @brief  Next daily summary of a scan
+  * @retval Success = 0, RFIDLOG_ITER_END after the last one
+  * @note   Blocks are read in bursts of up to RFIDLOG_ITER_SIZE bytes,
+  *			damaged blocks are skipped
+  */
+uint8_t RFIDLog_NextSummary(RFIDLog_SumIter *it, RFIDLog_Summary *sum)
+{
+	RFIDLog_SumBlock Block;
+
+	while (it->pos < it->count)
+	{
+		if (it->pos < it->bufPos || it->pos >= it->bufPos + it->bufBlocks)
+		{
+			uint16_t Block0 = (it->oldest + it->pos) % sumBlocks;
+			uint16_t Blocks = RFIDLOG_ITER_SIZE / RFIDSUM_BLOCK_SIZE;
+			if (Blocks > it->count - it->pos)
+			{
+				Blocks = it->count - it->pos;
+			}
+			if (Blocks > sumBlocks - Block0)
+			{
+				Blocks = sumBlocks - Block0;
+			}
+			AT24Cxx_ReadByte(RFIDLog_SumAddr(Block0), it->buf,
+					Blocks * RFIDSUM_BLOCK_SIZE);
+			it->bufPos = it->pos;
+			it->bufBlocks = (uint8_t)Blocks;
+		}
+
+		memcpy(&Block, &it->buf[(it->pos - it->bufPos) * RFIDSUM_BLOCK_SIZE],
+				RFIDSUM_BLOCK_SIZE);
+		if (!RFIDLog_SumIsValid(&Block))
+		{
+			it->pos++;
+			it->entry = 0;
+			continue;
+		}
+		/* Dates grow along the ring */
+		if (Block.date > it->to)
+		{
+			it->pos = it->count;
+			break;
+		}
+
+		RFIDLog_SumEntry Entry = Block.entry[it->entry];
+		if (++it->entry == RFIDSUM_ENTRIES)
+		{
+			it->entry = 0;
+			it->pos++;
+		}
+		if (Entry.first == RFIDSUM_VOID)
+		{
+			continue;
+		}
+
+		uint32_t Day = (uint32_t)Block.date * 86400UL;
+		memcpy(sum->uid, Entry.uid, RFIDREC_UID_MAX);
+		sum->uidSize = RFIDSUM_UID_SIZE(Entry.first);
+		sum->date = Block.date;
+		sum->first = RFIDRec_SecondsToStamp(Day +
+				(RFIDSUM_MINUTE(Entry.first) * 60UL));
+		sum->last = RFIDRec_SecondsToStamp(Day + (Entry.last * 60UL));
+		return 0;
+	}
+
+	return RFIDLOG_ITER_END;
+}
+
+/**
+  * @brief  Daily summaries the EEPROM holds before the oldest are overwritten
+  */
+uint16_t RFIDLog_SummaryCapacity(void)
+{
+	return sumBlocks * RFIDSUM_ENTRIES;
+}
+
+/**
+  * @brief  Add bytes at the end of the staging buffer
+  */
+static void RFIDLog_Stage(const void *Data, uint8_t Len)
+{
+	if (stageLen + Len > RFIDLOG_STAGE_SIZE)
+	{
+		RFIDLog_WriteBack(1);
+	}
+	if (stageLen == 0)
+	{
+		stageTick = HAL_GetTick();
+	}
+
+	memcpy(&stageBuf[stageLen], Data, Len);
+	stageLen += Len;
+}
+
+/**
+  * @brief  Start the next pass over the ring
+  */
+static void RFIDLog_Wrap(void)
+{
+	/* Every slot of this pass is written, the next pass starts over at
+	 * slot 0 and overwrites the oldest records one by one */
+	RFIDLog_WriteBack(1);
+	hdr.pass++;
+	RFIDLog_WriteHeader();
+	head = 0;
+	stageAddr = RFIDLOG_BASE_ADDR;
+}
+
+/**
+  * @brief  Append a record, full pages are written through immediately
+  * @note   A full log evicts its oldest record
+  * @retval Ring slot of the new record, RFIDLOG_NO_SLOT if the compact
+  *         roster has no room for a new UID
+  */
+uint16_t RFIDLog_Append(const RFID_Record *rec)
+{
+	// Circular Buffer Logic
+	if (head >= capacity)
+	{
+		RFIDLog_Wrap();
+	}
+
+#ifdef RFIDLOG_COMPACT
+	uint16_t Roster = RFIDLog_RosterIndex(rec);
+	uint32_t Sec = RFIDRec_StampToSeconds(rec->stamp);
+	uint32_t Event;
+
+	if (Roster == RFIDCMP_ROSTER_VOID)
+	{
+		return RFIDLOG_NO_SLOT;
+	}
+
+	/* A gap the delta cannot hold, a clock set back or a cleared log needs
+	 * a new base */
+	uint8_t Rebase = (head % RFIDLOG_BLOCK_SLOTS) && (Sec < blockSeconds ||
+			Sec - blockSeconds > RFIDCMP_DELTA_MAX ||
+			RFIDLog_HeadSeq() < hdr.start);
+	RFIDLog_Evict(RFIDLog_HeadSeq() + 1 + (Rebase ? RFIDLOG_BLOCK_SLOTS -
+			(head % RFIDLOG_BLOCK_SLOTS) : 0));
+	if (Rebase)
+	{
+		Event = RFIDCmp_MakeEvent(hdr.pass, 0, RFIDCMP_ROSTER_VOID, 0);
+		while (head % RFIDLOG_BLOCK_SLOTS)
+		{
+			RFIDLog_Stage(&Event, RFIDLOG_SLOT_SIZE);
+			head++;
+		}
+		if (head >= capacity)
+		{
+			RFIDLog_Wrap();
+		}
+	}
+	if ((head % RFIDLOG_BLOCK_SLOTS) == 0)
+	{
+		RFID_CompactBase Base = {
+			.info = RFIDREC_INFO_WITH_LAP(RFIDCMP_VERSION << 6, hdr.pass),
+			.reserved = 0,
+			.stamp = rec->stamp
+		};
+		Base.crc = RFIDCmp_BaseChecksum(&Base);
+		RFIDLog_Stage(&Base, RFIDCMP_BASE_SIZE);
+		blockSeconds = Sec;
+	}
+	RFIDLog_DayNote(RFIDLog_HeadSeq(), rec->stamp);
+	Event = RFIDCmp_MakeEvent(hdr.pass, RFIDREC_INFO_STATUS(rec->info),
+			Roster, Sec - blockSeconds);
+	RFIDLog_Stage(&Event, RFIDLOG_SLOT_SIZE);
+	blockSeconds = Sec;
+#else
+	RFIDLog_Evict(RFIDLog_HeadSeq() + 1);
+	RFIDLog_DayNote(RFIDLog_HeadSeq(), rec->stamp);
+
+	RFID_Record Staged = *rec;
+	Staged.info = RFIDREC_INFO_WITH_LAP(rec->info, hdr.pass);
+	Staged.crc = RFIDRec_Checksum(&Staged);
+	RFIDLog_Stage(&Staged, RFIDREC_SIZE);
+#endif
+	head++;
+
+	RFIDLog_WriteBack(0);
+
+	return head - 1;
+}
+
+/**
+  * @brief  Find the newest record of a UID through the sorted directory
+  * @note   Records RFIDLog_Maintain() has not entered yet are checked one
+  *         by one, up to RFIDLOG_DIR_PENDING of them.
+  * @retval 0 = in the log, *slot is its ring slot, 1 = not in the log,
+  *         2 = unknown, the log has to be scanned: there is no directory,
+  *         it ran full or it is being rebuilt
+  */
+uint8_t RFIDLog_FindUID(const uint8_t *uid, uint8_t uidSize, uint16_t *slot)
+{
+	RFIDLog_DirEntry Key;
+	RFIDLog_DirEntry Entry;
+	RFID_Record Rec;
+	uint16_t Pos;
+	uint32_t Seq = RFIDLog_HeadSeq();
+	uint32_t First = RFIDLog_FirstSeq();
+
+	if (dirSeq > First)
+	{
+		First = (dirSeq < Seq) ? dirSeq : Seq;
+	}
+	if (dirSlots == 0 || dirVerify || dirErase > dirAddr ||
+			Seq - First > RFIDLOG_DIR_PENDING)
+	{
+		return 2;
+	}
+	while (Seq-- > First)
+	{
+		uint16_t Slot = (uint16_t)(Seq % capacity);
+		if (RFIDLog_ReadAt(Slot, &Rec) == 0 &&
+				RFIDREC_INFO_UID_SIZE(Rec.info) == uidSize &&
+				memcmp(Rec.uid, uid, uidSize) == 0)
+		{
+			*slot = Slot;
+			return 0;
+		}
+	}
+
+	RFIDLog_DirKey(&Key, uid, uidSize);
+	if (RFIDLog_DirSearch(&Key, &Pos, &Entry) && RFIDLog_DirMatches(&Entry))
+	{
+		*slot = Entry.slot;
+		return 0;
+	}
+
+	return dirFull ? 2 : 1;
+}
+
+/**
+  * @brief  Empty the log by moving its start up to the head
+  * @note   Nothing is erased: the start acts as the generation marker,
+  *         older records are ignored and overwritten as the ring comes
+  *         round to them. Costs one header write.
+  * @retval Success = 0, Failed = 1
+  */
+uint8_t RFIDLog_Clear(void)
+{
+	if (RFIDLog_Count() != 0)
+	{
+		/* The head is derived from the records, so they have to be in
+		 * EEPROM before the header points past them */
+		if (RFIDLog_Sync() != 0)
+		{
+			return 1;
+		}
+		hdr.start = RFIDLog_HeadSeq();
+#ifdef RFIDLOG_COMPACT
+		/* The log restarts with a fresh block, the filler in front of it
+		 * is not part of the log */
+		hdr.start += (RFIDLOG_BLOCK_SLOTS - (head % RFIDLOG_BLOCK_SLOTS)) %
+				RFIDLOG_BLOCK_SLOTS;
+#endif
+		if (RFIDLog_WriteHeader() != 0)
+		{
+			return 1;
+		}
+	}
+	RFIDLog_RollReset();
+
+	/* Every entry is stale now and is dropped once the directory runs
+	 * full, a UID left out before is no longer in the log */
+	dirFull = 0;
+#ifdef RFIDLOG_COMPACT
+	/* No event refers to the roster any more, make room for new UIDs */
+	if (rosterCount >= rosterSize || rosterCount >= RFIDCMP_ROSTER_VOID)
+	{
+		return RFIDLog_RosterReset();
+	}
+#endif
+	return 0;
+}
+
+/**
+  * @brief  Empty the log and erase the records of earlier generations in the
+  *			background, see RFIDLog_Maintain()
+  * @retval Success = 0, Failed = 1
+  * @note   The log starts over with a new pass, so no slot is current and
+  *			the ring may be erased from the top down to the new records.
+  *			Directory and day index entries go stale like on a clear.
+  */
+uint8_t RFIDLog_Wipe(void)
+{
+	if (AT24Cxx_EraseLeft() != 0 || RFIDLog_Sync() != 0)
+	{
+		return 1;
+	}
+	hdr.pass++;
+	head = 0;
+	hdr.start = RFIDLog_HeadSeq();
+	stageAddr = RFIDLOG_BASE_ADDR;
+	if (RFIDLog_WriteHeader() != 0)
+	{
+		return 1;
+	}
+	RFIDLog_CacheReset();
+	dirFull = 0;
+	RFIDLog_RollReset();
+#ifdef RFIDLOG_COMPACT
+	if (rosterCount >= rosterSize || rosterCount >= RFIDCMP_ROSTER_VOID)
+	{
+		RFIDLog_RosterReset();
+	}
+#endif
+
+	if (AT24Cxx_EraseStart(RFIDLOG_BASE_ADDR,
+			RFIDLOG_RING_END - RFIDLOG_BASE_ADDR) != 0)
+	{
+		return 1;
+	}
+	wipeTotal = RFIDLOG_RING_END - RFIDLOG_BASE_ADDR;
+
+	return 0;
+}
+
+/**
+  * @brief  Run one step of the background work: a page of the wipe or,
+  *			without one, a directory update, a roster reclaim step or a
+  *			roll-up batch
+  * @retval Wipe progress in percent, 100 when there is no wipe running
+  * @note   Call it when the bus is quiet, e.g. while no card is in the field
+  */
+uint8_t RFIDLog_Maintain(void)
+{
+	if (wipeTotal == 0)
+	{
+		uint8_t Busy = RFIDLog_DirStep();
+#ifdef RFIDLOG_COMPACT
+		Busy = Busy || RFIDLog_RosterStep();
+#endif
+		/* Roll up the oldest day once the ring runs short of free slots */
+		if (!Busy && (rollActive ||
+				RFIDLog_Count() + RFIDLog_Reserve() > capacity))
+		{
+			RFIDLog_Rollup();
+		}
+		return 100;
+	}
+
+	/* New records go in from the start of the ring, the erase stays above
+	 * everything appended so far */
+	AT24Cxx_EraseLimit(stageAddr + stageLen);
+	uint8_t Status = AT24Cxx_EraseStep();
+	if (Status != 1)
+	{
+		if (Status == 2)
+		{
+			writeErrors++;
+		}
+		wipeTotal = 0;
+		return 100;
+	}
+
+	uint8_t Done = (uint8_t)(100 - ((AT24Cxx_EraseLeft() * 100) / wipeTotal));
+	return (Done < 100) ? Done : 99;
+}
+
+/**
+  * @brief  Start writing every staged record out to EEPROM
+  * @retval Success = 0, Failed = 1
+  */
+uint8_t RFIDLog_Flush(void)
+{
+	return RFIDLog_WriteBack(1);
+}
+
+/**
+  * @brief  Write every staged record and wait until it is in EEPROM
+  * @retval Success = 0, Failed = 1
+  */
+uint8_t RFIDLog_Sync(void)
+{
+	uint16_t Errors = writeErrors;
+
+	if (RFIDLog_WriteBack(1) != 0)
+	{
+		return 1;
+	}
+	AT24Cxx_Sync();
+
+	return (writeErrors != Errors);
+}
+
+/**
+  * @brief  Number of write-backs the EEPROM driver reported as failed
+  */
+uint16_t RFIDLog_WriteErrors(void)
+{
+	return writeErrors;
+}
+
+/**
+  * @brief  Number of torn pages the last RFIDLog_Init() repaired
+  */
+uint16_t RFIDLog_Recovered(void)
+{
+	return recovered;
+}
+
+/**
+  * @brief  Register a function told about every record a full log overwrites
+  */
+void RFIDLog_SetEvictHandler(RFIDLog_EvictFn fn)
+{
+	evictHandler = fn;
+}
+
+/**
+  * @brief  Flush the staging buffer once its oldest record is too old
+  */
+void RFIDLog_Poll(void)
+{
+	if (stageLen && (HAL_GetTick() - stageTick >= RFIDLOG_FLUSH_LATENCY_MS))
+	{
+		RFIDLog_WriteBack(1);
+	}
+}
@@ -0,0 +1,140 @@
+/**
+  ******************************************************************************
+  * @file    uid_index.c
+  * @brief   Open-addressing (linear probing) UID hash index kept in SRAM
+  ******************************************************************************
+  */
+#include "uid_index.h"
+
+static uint16_t slotLog[UID_INDEX_SLOTS];	// Log index, UID_INDEX_EMPTY if free
+static uint8_t slotTag[UID_INDEX_SLOTS];	// Upper hash bits of the stored UID
+static uint16_t entries;
+static uint16_t deleted;		// Tombstones
+static uint8_t overflowed;
+
+/**
+  * @brief  FNV-1a hash of the UID bytes
+  */
+static uint32_t UID_Index_Hash(const uint8_t *uid, uint8_t len)
+{
+	uint32_t h = 2166136261UL;
+
+	for (uint8_t i = 0; i < len; i++)
+	{
+		h ^= uid[i];
+		h *= 16777619UL;
+	}
+	return h;
+}
+
+/**
+  * @brief  Drop every entry, the index becomes complete for an empty log
+  */
+void UID_Index_Clear(void)
+{
+	for (uint16_t i = 0; i < UID_INDEX_SLOTS; i++)
+	{
+		slotLog[i] = UID_INDEX_EMPTY;
+	}
+	entries = 0;
+	deleted = 0;
+	overflowed = 0;
+}
+
+/**
+  * @brief  Record that the UID was written at logIndex
+  * @retval Success = 0, Failed = 1 (table full, index no longer complete)
+  */
+uint8_t UID_Index_Insert(const uint8_t *uid, uint8_t len, uint16_t logIndex)
+{
+	if (entries >= UID_INDEX_MAX_LOAD)
+	{
+		overflowed = 1;
+		return 1;
+	}
+
+	uint32_t h = UID_Index_Hash(uid, len);
+	uint16_t slot = h & (UID_INDEX_SLOTS - 1);
+
+	while (slotLog[slot] != UID_INDEX_EMPTY &&
+			slotLog[slot] != UID_INDEX_DELETED)
+	{
+		slot = (slot + 1) & (UID_INDEX_SLOTS - 1);
+	}
+	if (slotLog[slot] == UID_INDEX_DELETED)
+	{
+		deleted--;
+	}
+	slotLog[slot] = logIndex;
+	slotTag[slot] = (uint8_t)(h >> 24);
+	entries++;
+
+	return 0;
+}
+
+/**
+  * @brief  Look up a UID, confirming tag hits through the match callback
+  * @retval UID_INDEX_HIT, UID_INDEX_MISS or UID_INDEX_UNKNOWN
+  */
+UID_Index_Result UID_Index_Lookup(const uint8_t *uid, uint8_t len,
+		UID_Index_MatchFn match)
+{
+	uint32_t h = UID_Index_Hash(uid, len);
+	uint16_t slot = h & (UID_INDEX_SLOTS - 1);
+	uint8_t tag = (uint8_t)(h >> 24);
+
+	/* Tombstones may leave no empty slot, so the probe length is bounded */
+	for (uint16_t n = 0; n < UID_INDEX_SLOTS &&
+			slotLog[slot] != UID_INDEX_EMPTY; n++)
+	{
+		if (slotLog[slot] != UID_INDEX_DELETED && slotTag[slot] == tag &&
+				match(slotLog[slot], uid, len))
+		{
+			return UID_INDEX_HIT;
+		}
+		slot = (slot + 1) & (UID_INDEX_SLOTS - 1);
+	}
+
+	return overflowed ? UID_INDEX_UNKNOWN : UID_INDEX_MISS;
+}
+
+/**
+  * @brief  Forget the entry of an evicted log record
+  * @retval Success = 0, Failed = 1 (no entry for this UID and log index)
+  */
+uint8_t UID_Index_Remove(const uint8_t *uid, uint8_t len, uint16_t logIndex)
+{
+	uint32_t h = UID_Index_Hash(uid, len);
+	uint16_t slot = h & (UID_INDEX_SLOTS - 1);
+	uint8_t tag = (uint8_t)(h >> 24);
+
+	for (uint16_t n = 0; n < UID_INDEX_SLOTS &&
+			slotLog[slot] != UID_INDEX_EMPTY; n++)
+	{
+		if (slotLog[slot] == logIndex && slotTag[slot] == tag)
+		{
+			slotLog[slot] = UID_INDEX_DELETED;
+			entries--;
+			deleted++;
+			return 0;
+		}
+		slot = (slot + 1) & (UID_INDEX_SLOTS - 1);
+	}
+
+	return 1;
+}
+
+uint16_t UID_Index_Count(void)
+{
+	return entries;
+}
+
+uint16_t UID_Index_Deleted(void)
+{
+	return deleted;
+}
+
+uint8_t UID_Index_IsComplete(void)
+{
+	return !overflowed;
+}
@@ -0,0 +1,44 @@
+/**
+  ******************************************************************************
+  * @file    export.hpp
+  * @brief   CSV and binary export of decoded EEPROM images
+  ******************************************************************************
+  * @attention
+  * Usage:
+  *		Exports append to a std::string, so images decoded in parallel can
+  *		be written out in order.
+  *		Record CSV:  image,seq,slot,date,time,uid,status
+  *		Summary CSV: image,date,uid,first,last
+  *		Binary: the records as RFID_Record, 16 bytes each with a valid CRC,
+  *		oldest first, whatever layout the image uses.
+  *		UIDs are upper case hex of uidSize bytes, dates YYYY-MM-DD.
+  *
+  ******************************************************************************
+  */
+#ifndef RFIDLOG_EXPORT_HPP
+#define RFIDLOG_EXPORT_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rfidlog/image.hpp"
+
+namespace rfidlog
+{
+
+void appendUid(std::string &out, const uint8_t *uid, uint8_t uidSize);
+void appendStamp(std::string &out, uint32_t stamp);
+bool parseUid(const std::string &hex, uint8_t uid[RFIDREC_UID_MAX], uint8_t &uidSize);
+
+void appendRecordsCsvHeader(std::string &out);
+void appendRecordCsv(std::string &out, const std::string &name, const Record &r);
+void appendRecordsCsv(std::string &out, const std::string &name, const Image &image);
+void appendRecordsBinary(std::string &out, const Image &image);
+
+void appendSummariesCsvHeader(std::string &out);
+void appendSummariesCsv(std::string &out, const std::string &name, const Image &image);
+
+}	// namespace rfidlog
+
+#endif	/* RFIDLOG_EXPORT_HPP */
@@ -0,0 +1,214 @@
+/**
+  ******************************************************************************
+  * @file    image.hpp
+  * @brief   Attendance log decoder for AT24Cxx EEPROM images
+  ******************************************************************************
+  * @attention
+  * Usage:
+  *		An Image maps a dump of the log address space (AT24Cxx_ReadByte()
+  *		addresses, striped devices already joined) and decodes it with the
+  *		firmware's own definitions from rfid_record.h. Nothing is copied up
+  *		front: the header and the ring head are located like RFIDLog_Init()
+  *		does, records are decoded while iterating.
+  *		16 byte ring records are handed out in place, pointing into the
+  *		mapping. Compact events and legacy 12 byte records are decoded into
+  *		the iterator, that record is valid until the iterator moves on.
+  *		Iterators skip damaged records (CRC mismatch) and compact filler,
+  *		damaged() counts them.
+  *		Images in a layout this decoder does not know throw
+  *		std::runtime_error, as do images shorter than the log they hold.
+  *
+  ******************************************************************************
+  */
+#ifndef RFIDLOG_IMAGE_HPP
+#define RFIDLOG_IMAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "rfid_record.h"
+#include "rfidlog/mapped_file.hpp"
+
+namespace rfidlog
+{
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+		"images are decoded in place, the host must be little endian like the MCU");
+
+enum class Format
+{
+	Blank,			// No header and no legacy counter
+	Legacy,			// 2 byte counter at 0x0000, packed 12 byte records
+	Ring,			// RFIDLOG_LAYOUT, 16 byte RFID_Record slots
+	Compact			// RFIDLOG_LAYOUT_COMPACT, compact blocks and roster
+};
+
+const char *formatName(Format format);
+
+/* Slot status like RFIDLog_Read() */
+enum : uint8_t
+{
+	SLOT_OK = 0,
+	SLOT_DAMAGED = 1,
+	SLOT_FILLER = 2
+};
+
+struct Record
+{
+	uint32_t seq;				// Sequence number, log index in the legacy layout
+	uint16_t slot;				// Ring slot, log index in the legacy layout
+	const RFID_Record *rec;
+};
+
+/* A record copied out of the image, see Image::find() */
+struct Match
+{
+	uint32_t seq;
+	uint16_t slot;
+	RFID_Record rec;
+};
+
+struct Summary
+{
+	uint16_t date;				// Days since 2000-01-01
+	const uint8_t *uid;			// RFIDREC_UID_MAX bytes in the image
+	uint8_t uidSize;
+	uint16_t first;				// Minute of the day of the first tap
+	uint16_t last;				// Minute of the day of the last tap
+};
+
+template <class It>
+struct Range
+{
+	It first;
+	It last;
+
+	It begin() const { return first; }
+	It end() const { return last; }
+};
+
+class Image;
+
+class RecordIterator
+{
+public:
+	using iterator_category = std::input_iterator_tag;
+	using value_type = Record;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const Record *;
+	using reference = const Record &;
+
+	RecordIterator() = default;
+	RecordIterator(const Image *image, uint32_t seq, uint32_t end);
+	RecordIterator(const RecordIterator &other) { *this = other; }
+	RecordIterator &operator=(const RecordIterator &other);
+
+	reference operator*() const { return cur_; }
+	pointer operator->() const { return &cur_; }
+	RecordIterator &operator++();
+	bool operator==(const RecordIterator &other) const { return cur_.seq == other.cur_.seq; }
+	bool operator!=(const RecordIterator &other) const { return !(*this == other); }
+
+private:
+	void settle(uint32_t seq);
+
+	const Image *image_ = nullptr;
+	uint32_t end_ = 0;
+	Record cur_ = {};
+	RFID_Record buf_ = {};		// Decoded record, compact and legacy layouts
+};
+
+class SummaryIterator
+{
+public:
+	using iterator_category = std::input_iterator_tag;
+	using value_type = Summary;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const Summary *;
+	using reference = const Summary &;
+
+	SummaryIterator() = default;
+	SummaryIterator(const Image *image, uint32_t pos);
+
+	reference operator*() const { return cur_; }
+	pointer operator->() const { return &cur_; }
+	SummaryIterator &operator++();
+	bool operator==(const SummaryIterator &other) const { return pos_ == other.pos_; }
+	bool operator!=(const SummaryIterator &other) const { return !(*this == other); }
+
+private:
+	void settle(uint32_t pos);
+
+	const Image *image_ = nullptr;
+	uint32_t pos_ = 0;			// Block from the oldest one * 2 + entry
+	Summary cur_ = {};
+};
+
+class Image
+{
+public:
+	explicit Image(const std::string &path);
+	Image(const uint8_t *data, size_t size);	// The bytes must outlive the image
+
+	Format format() const { return format_; }
+	const RFIDLog_Header &header() const { return hdr_; }
+	const RFIDLog_Layout &layout() const { return layout_; }
+	uint32_t logSize() const { return logSize_; }
+	uint8_t devices() const;
+	uint16_t head() const { return head_; }
+	uint32_t firstSeq() const { return first_; }
+	uint32_t headSeq() const { return headSeq_; }
+	uint32_t count() const { return headSeq_ - first_; }
+	uint16_t rosterCount() const { return rosterCount_; }
+	bool torn() const { return torn_; }
+
+	Range<RecordIterator> records() const;
+	uint32_t damaged() const;
+	std::vector<Match> find(const uint8_t *uid, uint8_t uidSize) const;
+
+	Range<SummaryIterator> summaries() const;
+	uint32_t summaryBlocks() const { return sumCount_; }
+
+	uint8_t decode(uint32_t seq, RFID_Record &buf, const RFID_Record *&rec) const;
+	const RFIDLog_SumBlock *summaryBlock(uint32_t pos) const;
+
+private:
+	void parse();
+	bool loadHeader();
+	bool loadLegacy();
+	uint32_t blockAddr(uint16_t slot) const;
+	uint32_t slotAddr(uint16_t slot) const;
+	uint16_t slotAt(uint32_t addr) const;
+	uint8_t slotLap(uint16_t slot) const;
+	uint8_t dataLap(uint16_t slot) const;
+	void findHead();
+	void loadRoster();
+	void loadSummaries();
+	uint8_t sumLap(uint16_t block) const;
+	template <class T> const T *at(uint32_t addr) const;
+
+	std::optional<MappedFile> file_;
+	const uint8_t *data_ = nullptr;
+	size_t size_ = 0;
+
+	Format format_ = Format::Blank;
+	RFIDLog_Header hdr_ = {};
+	RFIDLog_Layout layout_ = {};
+	uint32_t logSize_ = 0;
+	uint16_t pageSize_ = RFIDLOG_RING_BLOCK;	// Device page size, torn writes
+	uint16_t head_ = 0;
+	uint32_t first_ = 0;
+	uint32_t headSeq_ = 0;
+	uint16_t rosterCount_ = 0;
+	bool torn_ = false;
+	uint16_t sumOldest_ = 0;
+	uint16_t sumCount_ = 0;
+};
+
+}	// namespace rfidlog
+
+#endif	/* RFIDLOG_IMAGE_HPP */
@@ -0,0 +1,41 @@
+/**
+  ******************************************************************************
+  * @file    mapped_file.hpp
+  * @brief   Read-only memory mapping of an EEPROM image
+  ******************************************************************************
+  */
+#ifndef RFIDLOG_MAPPED_FILE_HPP
+#define RFIDLOG_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace rfidlog
+{
+
+/* The whole file is mapped once, its pages are only read in on access */
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::string &path);	// Throws std::system_error, the caller names the file
+	~MappedFile();
+
+	MappedFile(MappedFile &&other) noexcept;
+	MappedFile &operator=(MappedFile &&other) noexcept;
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	const uint8_t *data() const { return data_; }
+	size_t size() const { return size_; }
+
+private:
+	void release();
+
+	const uint8_t *data_ = nullptr;
+	size_t size_ = 0;
+};
+
+}	// namespace rfidlog
+
+#endif	/* RFIDLOG_MAPPED_FILE_HPP */
@@ -0,0 +1,167 @@
+/**
+  ******************************************************************************
+  * @file    export.cpp
+  * @brief   CSV and binary export of decoded EEPROM images
+  ******************************************************************************
+  */
+#include "rfidlog/export.hpp"
+
+#include <cctype>
+
+namespace rfidlog
+{
+
+/* Fields are formatted by hand, a batch of dumps is millions of lines */
+static void AppendNumber(std::string &out, uint32_t value)
+{
+	char Digits[10];
+	uint8_t n = 0;
+
+	do
+	{
+		Digits[n++] = (char)('0' + (value % 10));
+		value /= 10;
+	} while (value != 0);
+	while (n > 0)
+	{
+		out.push_back(Digits[--n]);
+	}
+}
+
+static void AppendTwo(std::string &out, uint32_t value)
+{
+	out.push_back((char)('0' + ((value / 10) % 10)));
+	out.push_back((char)('0' + (value % 10)));
+}
+
+static void AppendDate(std::string &out, uint32_t stamp)
+{
+	AppendNumber(out, 2000 + RFIDREC_YEAR(stamp));
+	out.push_back('-');
+	AppendTwo(out, RFIDREC_MONTH(stamp));
+	out.push_back('-');
+	AppendTwo(out, RFIDREC_DAY(stamp));
+}
+
+static void AppendMinute(std::string &out, uint16_t minute)
+{
+	AppendTwo(out, minute / 60);
+	out.push_back(':');
+	AppendTwo(out, minute % 60);
+}
+
+void appendUid(std::string &out, const uint8_t *uid, uint8_t uidSize)
+{
+	static const char Hex[] = "0123456789ABCDEF";
+
+	for (uint8_t i = 0; i < uidSize; i++)
+	{
+		out.push_back(Hex[uid[i] >> 4]);
+		out.push_back(Hex[uid[i] & 0x0F]);
+	}
+}
+
+/* Date and time as two CSV fields */
+void appendStamp(std::string &out, uint32_t stamp)
+{
+	AppendDate(out, stamp);
+	out.push_back(',');
+	AppendTwo(out, RFIDREC_HOUR(stamp));
+	out.push_back(':');
+	AppendTwo(out, RFIDREC_MINUTE(stamp));
+	out.push_back(':');
+	AppendTwo(out, RFIDREC_SECOND(stamp));
+}
+
+/**
+  * @brief  Parse a UID given as hex, separators ':' and '-' are ignored
+  * @retval A 4, 7 or 10 byte UID
+  */
+bool parseUid(const std::string &hex, uint8_t uid[RFIDREC_UID_MAX], uint8_t &uidSize)
+{
+	std::string Digits;
+
+	for (char c : hex)
+	{
+		if (std::isxdigit((unsigned char)c))
+		{
+			Digits.push_back(c);
+		}
+		else if (c != ':' && c != '-')
+		{
+			return false;
+		}
+	}
+	uidSize = (uint8_t)(Digits.size() / 2);
+	if ((Digits.size() % 2) != 0 || (uidSize != 4 && uidSize != 7 && uidSize != 10))
+	{
+		return false;
+	}
+	for (uint8_t i = 0; i < RFIDREC_UID_MAX; i++)
+	{
+		uid[i] = (i < uidSize) ? (uint8_t)std::stoul(Digits.substr(i * 2, 2),
+				nullptr, 16) : 0;
+	}
+	return true;
+}
+
+void appendRecordsCsvHeader(std::string &out)
+{
+	out += "image,seq,slot,date,time,uid,status\n";
+}
+
+void appendRecordCsv(std::string &out, const std::string &name, const Record &r)
+{
+	out += name;
+	out.push_back(',');
+	AppendNumber(out, r.seq);
+	out.push_back(',');
+	AppendNumber(out, r.slot);
+	out.push_back(',');
+	appendStamp(out, r.rec->stamp);
+	out.push_back(',');
+	appendUid(out, r.rec->uid, RFIDREC_INFO_UID_SIZE(r.rec->info));
+	out.push_back(',');
+	AppendNumber(out, RFIDREC_INFO_STATUS(r.rec->info));
+	out.push_back('\n');
+}
+
+void appendRecordsCsv(std::string &out, const std::string &name, const Image &image)
+{
+	for (const Record &R : image.records())
+	{
+		appendRecordCsv(out, name, R);
+	}
+}
+
+void appendRecordsBinary(std::string &out, const Image &image)
+{
+	for (const Record &R : image.records())
+	{
+		out.append(reinterpret_cast<const char *>(R.rec), RFIDREC_SIZE);
+	}
+}
+
+void appendSummariesCsvHeader(std::string &out)
+{
+	out += "image,date,uid,first,last\n";
+}
+
+void appendSummariesCsv(std::string &out, const std::string &name, const Image &image)
+{
+	for (const Summary &S : image.summaries())
+	{
+		out += name;
+		out.push_back(',');
+		AppendDate(out, RFIDRec_SecondsToStamp((uint32_t)S.date * 86400UL));
+		out.push_back(',');
+		appendUid(out, S.uid, S.uidSize);
+		out.push_back(',');
+		AppendMinute(out, S.first);
+		out.push_back(',');
+		AppendMinute(out, S.last);
+		out.push_back('\n');
+	}
+}
+
+}	// namespace rfidlog
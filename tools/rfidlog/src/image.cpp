@@ -0,0 +1,601 @@
+/**
+  ******************************************************************************
+  * @file    image.cpp
+  * @brief   Attendance log decoder for AT24Cxx EEPROM images
+  ******************************************************************************
+  * @attention
+  * Mirrors the read side of rfid_log.c: header copy selection, the bisection
+  * for the ring head, torn block recovery and the summary ring. Keep both in
+  * step when the format changes; the structs and layout come from
+  * rfid_record.h and are shared already.
+  *
+  ******************************************************************************
+  */
+#include "rfidlog/image.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace rfidlog
+{
+
+const char *formatName(Format format)
+{
+	switch (format)
+	{
+	case Format::Legacy:
+		return "legacy";
+	case Format::Ring:
+		return "ring";
+	case Format::Compact:
+		return "compact";
+	default:
+		return "blank";
+	}
+}
+
+/* Record Iterator -----------------------------------------------------------*/
+RecordIterator::RecordIterator(const Image *image, uint32_t seq, uint32_t end)
+	: image_(image), end_(end)
+{
+	settle(seq);
+}
+
+RecordIterator &RecordIterator::operator=(const RecordIterator &other)
+{
+	image_ = other.image_;
+	end_ = other.end_;
+	cur_ = other.cur_;
+	buf_ = other.buf_;
+	/* A decoded record lives in the iterator, not in the image */
+	if (other.cur_.rec == &other.buf_)
+	{
+		cur_.rec = &buf_;
+	}
+	return *this;
+}
+
+RecordIterator &RecordIterator::operator++()
+{
+	settle(cur_.seq + 1);
+	return *this;
+}
+
+/**
+  * @brief  Move to the first valid record at or after seq, or to the end
+  */
+void RecordIterator::settle(uint32_t seq)
+{
+	for (; seq < end_; seq++)
+	{
+		const RFID_Record *rec;
+		if (image_->decode(seq, buf_, rec) == SLOT_OK)
+		{
+			cur_.seq = seq;
+			cur_.slot = (image_->format() == Format::Legacy) ? (uint16_t)seq :
+					(uint16_t)(seq % image_->layout().capacity);
+			cur_.rec = rec;
+			return;
+		}
+	}
+	cur_ = Record{ end_, 0, nullptr };
+}
+
+/* Summary Iterator ----------------------------------------------------------*/
+SummaryIterator::SummaryIterator(const Image *image, uint32_t pos)
+	: image_(image)
+{
+	settle(pos);
+}
+
+SummaryIterator &SummaryIterator::operator++()
+{
+	settle(pos_ + 1);
+	return *this;
+}
+
+/**
+  * @brief  Move to the first used entry of a valid block at or after pos
+  */
+void SummaryIterator::settle(uint32_t pos)
+{
+	const uint32_t End = (uint32_t)image_->summaryBlocks() * RFIDSUM_ENTRIES;
+
+	for (pos_ = pos; pos_ < End; pos_++)
+	{
+		const RFIDLog_SumBlock *Block = image_->summaryBlock(pos_ / RFIDSUM_ENTRIES);
+		if (Block == nullptr)
+		{
+			pos_ += RFIDSUM_ENTRIES - 1 - (pos_ % RFIDSUM_ENTRIES);
+			continue;
+		}
+		const RFIDLog_SumEntry &Entry = Block->entry[pos_ % RFIDSUM_ENTRIES];
+		if (Entry.first == RFIDSUM_VOID)
+		{
+			continue;
+		}
+		cur_.date = Block->date;
+		cur_.uid = Entry.uid;
+		cur_.uidSize = RFIDSUM_UID_SIZE(Entry.first);
+		cur_.first = RFIDSUM_MINUTE(Entry.first);
+		cur_.last = Entry.last;
+		return;
+	}
+	pos_ = End;
+}
+
+/* Image ---------------------------------------------------------------------*/
+Image::Image(const std::string &path)
+	: file_(std::in_place, path)
+{
+	data_ = file_->data();
+	size_ = file_->size();
+	parse();
+}
+
+Image::Image(const uint8_t *data, size_t size)
+	: data_(data), size_(size)
+{
+	parse();
+}
+
+template <class T>
+const T *Image::at(uint32_t addr) const
+{
+	return reinterpret_cast<const T *>(data_ + addr);
+}
+
+uint8_t Image::devices() const
+{
+	return (format_ == Format::Ring || format_ == Format::Compact) ?
+			RFIDLOG_GEOMETRY_DEVICES(hdr_.geometry) : 1;
+}
+
+/**
+  * @brief  Find the layout, the header and the ring head
+  */
+void Image::parse()
+{
+	/* An empty file holds no log, like an erased EEPROM */
+	if (size_ == 0)
+	{
+		return;
+	}
+	if (size_ < RFIDLOG_BASE_ADDR)
+	{
+		throw std::runtime_error("image smaller than the log header");
+	}
+
+	if (!loadHeader())
+	{
+		if (!loadLegacy() && *at<uint32_t>(RFIDLOG_HEADER_ADDR) == RFIDLOG_MAGIC)
+		{
+			throw std::runtime_error("unsupported log layout " +
+					std::to_string(*at<uint8_t>(RFIDLOG_HEADER_ADDR + 4)));
+		}
+		return;
+	}
+
+	/* Size as probed by the firmware, the whole image if it never probed */
+	logSize_ = (uint32_t)((size_ < RFIDLOG_END_MAX) ? size_ : RFIDLOG_END_MAX);
+	uint32_t DeviceSize = logSize_;
+	if (hdr_.geometry != 0)
+	{
+		DeviceSize = 1UL << RFIDLOG_GEOMETRY_BITS(hdr_.geometry);
+		logSize_ = DeviceSize * RFIDLOG_GEOMETRY_DEVICES(hdr_.geometry);
+	}
+	pageSize_ = RFIDLog_PageSize(DeviceSize);
+	RFIDLog_MakeLayout(&layout_, logSize_, pageSize_, format_ == Format::Compact);
+	if (size_ < layout_.endAddr)
+	{
+		throw std::runtime_error("image truncated, " + std::to_string(size_) +
+				" of " + std::to_string(layout_.endAddr) + " bytes");
+	}
+
+	if (format_ == Format::Compact)
+	{
+		loadRoster();
+	}
+	findHead();
+	loadSummaries();
+}
+
+/**
+  * @brief  Select the newest valid header copy, like RFIDLog_LoadHeader()
+  * @retval A ring or compact header was found
+  */
+bool Image::loadHeader()
+{
+	bool Found = false;
+
+	for (uint8_t i = 0; i < RFIDLOG_HEADER_COPIES; i++)
+	{
+		const RFIDLog_Header &Copy = *at<RFIDLog_Header>(RFIDLOG_HEADER_ADDR +
+				(i * RFIDLOG_HEADER_SIZE));
+		bool Ring = Copy.layout == RFIDLOG_LAYOUT &&
+				Copy.recordSize == RFIDREC_SIZE;
+		bool Compact = Copy.layout == RFIDLOG_LAYOUT_COMPACT &&
+				Copy.recordSize == RFIDCMP_EVENT_SIZE;
+
+		if (Copy.magic != RFIDLOG_MAGIC || (!Ring && !Compact) ||
+				Copy.crc != RFIDLog_HeaderChecksum(&Copy))
+		{
+			continue;
+		}
+		if (!Found || (int16_t)(Copy.update - hdr_.update) > 0)
+		{
+			hdr_ = Copy;
+			format_ = Ring ? Format::Ring : Format::Compact;
+			Found = true;
+		}
+	}
+	return Found;
+}
+
+/**
+  * @brief  Recognise a log of the legacy layout by its counter at 0x0000
+  */
+bool Image::loadLegacy()
+{
+	uint16_t Count = *at<uint16_t>(RFIDLOG_LEGACY_COUNT_ADDR);
+
+	if (Count == 0xFFFF || Count == 0 || RFIDLOG_LEGACY_BASE_ADDR +
+			((uint32_t)Count * RFIDLOG_LEGACY_SIZE) > size_)
+	{
+		return false;
+	}
+
+	/* The firmware has started converting it: records are half moved */
+	RFIDLog_Layout Layout;
+	uint32_t Size = (uint32_t)((size_ < RFIDLOG_END_MAX) ? size_ : RFIDLOG_END_MAX);
+	RFIDLog_MakeLayout(&Layout, Size, RFIDLog_PageSize(Size), 0);
+	uint16_t StateAddr = RFIDLog_MigrateAddr(&Layout, Count);
+	for (uint8_t i = 0; i < RFIDLOG_MIGRATE_COPIES; i++)
+	{
+		if (RFIDLog_MigrateIsValid(at<RFIDLog_MigrateState>(StateAddr +
+				(i * RFIDLOG_MIGRATE_SIZE))))
+		{
+			throw std::runtime_error("legacy log conversion interrupted, "
+					"boot the firmware to finish it");
+		}
+	}
+
+	format_ = Format::Legacy;
+	logSize_ = (uint32_t)size_;
+	head_ = Count;
+	headSeq_ = Count;
+	return true;
+}
+
+uint32_t Image::blockAddr(uint16_t slot) const
+{
+	return RFIDLOG_BASE_ADDR + ((uint32_t)(slot / layout_.blockSlots) *
+			RFIDLOG_RING_BLOCK);
+}
+
+uint32_t Image::slotAddr(uint16_t slot) const
+{
+	return (format_ == Format::Compact) ? blockAddr(slot) + RFIDCMP_BASE_SIZE +
+			((slot % layout_.blockSlots) * RFIDCMP_EVENT_SIZE) :
+			blockAddr(slot) + ((slot % layout_.blockSlots) * RFIDREC_SIZE);
+}
+
+/**
+  * @brief  First ring slot at or above address addr, like RFIDLog_SlotAt()
+  */
+uint16_t Image::slotAt(uint32_t addr) const
+{
+	uint32_t Slot = 0;
+
+	if (addr > RFIDLOG_BASE_ADDR)
+	{
+		Slot = ((addr - RFIDLOG_BASE_ADDR + RFIDLOG_RING_BLOCK - 1) /
+				RFIDLOG_RING_BLOCK) * layout_.blockSlots;
+	}
+	return (Slot < layout_.capacity) ? (uint16_t)Slot : layout_.capacity;
+}
+
+/**
+  * @brief  Lap a slot was written in, 0xFF if it holds no valid data
+  */
+uint8_t Image::slotLap(uint16_t slot) const
+{
+	if (format_ == Format::Compact)
+	{
+		const RFID_CompactBase *Base = at<RFID_CompactBase>(blockAddr(slot));
+		uint32_t Event = *at<uint32_t>(slotAddr(slot));
+
+		if (!RFIDCmp_BaseIsValid(Base) || !RFIDCmp_EventIsValid(Event) ||
+				RFIDCMP_EVENT_LAP(Event) != RFIDREC_INFO_LAP(Base->info))
+		{
+			return 0xFF;
+		}
+		return RFIDCMP_EVENT_LAP(Event);
+	}
+
+	const RFID_Record *Rec = at<RFID_Record>(slotAddr(slot));
+	return RFIDRec_IsValid(Rec) ? RFIDREC_INFO_LAP(Rec->info) : 0xFF;
+}
+
+/**
+  * @brief  Lap of the slot data alone, without the compact block base
+  */
+uint8_t Image::dataLap(uint16_t slot) const
+{
+	if (format_ == Format::Compact)
+	{
+		uint32_t Event = *at<uint32_t>(slotAddr(slot));
+		return RFIDCmp_EventIsValid(Event) ? RFIDCMP_EVENT_LAP(Event) : 0xFF;
+	}
+	return slotLap(slot);
+}
+
+/**
+  * @brief  Locate the head and the oldest record, like RFIDLog_Init()
+  * @note   The firmware repairs a torn page at boot; here the head only
+  *			moves back below it and the start past the lost records
+  */
+void Image::findHead()
+{
+	const uint16_t Capacity = layout_.capacity;
+	const uint16_t PerBlock = layout_.blockSlots;
+
+	/* Slot 0 already in the next pass: only an older header copy survived */
+	if (slotLap(0) == ((hdr_.pass + 1) & 0x03))
+	{
+		hdr_.pass++;
+	}
+
+	uint16_t Lo = 0;
+	uint16_t Hi = Capacity;
+	while (Lo < Hi)
+	{
+		uint16_t Mid = Lo + ((Hi - Lo) / 2);
+		if (slotLap(Mid) == (hdr_.pass & 0x03))
+		{
+			Lo = Mid + 1;
+		}
+		else
+		{
+			Hi = Mid;
+		}
+	}
+	head_ = Lo;
+
+	/* Torn pages: a bad slot below the head or current data above it, in
+	 * any of the pages still in flight, one per striped device */
+	const uint32_t Span = (uint32_t)pageSize_ * (devices() - 1);
+	uint32_t Last = (head_ == 0) ? RFIDLOG_BASE_ADDR : slotAddr(head_ - 1);
+	Last -= Last % pageSize_;
+	for (uint16_t Slot = slotAt((Last > Span) ? Last - Span : 0); Slot < head_;
+			Slot++)
+	{
+		if (slotLap(Slot) != (hdr_.pass & 0x03))
+		{
+			head_ = Slot;
+			torn_ = true;
+		}
+	}
+	uint32_t Next = slotAddr(head_);
+	uint16_t End = slotAt(Next - (Next % pageSize_) + pageSize_ + Span);
+	for (uint16_t Slot = head_; Slot < End && !torn_; Slot++)
+	{
+		torn_ = (dataLap(Slot) == (hdr_.pass & 0x03));
+	}
+	if (torn_ && hdr_.pass > 0)
+	{
+		uint32_t Oldest = ((uint32_t)(hdr_.pass - 1) * Capacity) + End;
+		hdr_.start = (hdr_.start < Oldest) ? Oldest : hdr_.start;
+	}
+
+	/* At most one ring of records, a compact block loses its old events as
+	 * soon as its base is replaced */
+	const uint32_t Evict = (format_ == Format::Compact) ? PerBlock : 1;
+	headSeq_ = ((uint32_t)hdr_.pass * Capacity) + head_;
+	first_ = headSeq_ + (Evict - 1);
+	first_ -= first_ % Evict;
+	first_ = (first_ > Capacity) ? first_ - Capacity : 0;
+	first_ = (hdr_.start > first_) ? hdr_.start : first_;
+	first_ = (first_ > headSeq_) ? headSeq_ : first_;
+}
+
+/**
+  * @brief  Count the roster entries, the valid ones form a prefix
+  */
+void Image::loadRoster()
+{
+	for (rosterCount_ = 0; rosterCount_ < layout_.rosterSize &&
+			rosterCount_ < RFIDCMP_ROSTER_VOID; rosterCount_++)
+	{
+		if (!RFIDRec_IsValid(at<RFID_Record>(layout_.rosterAddr +
+				(rosterCount_ * RFIDREC_SIZE))))
+		{
+			break;
+		}
+	}
+}
+
+uint8_t Image::sumLap(uint16_t block) const
+{
+	const RFIDLog_SumBlock *Block = at<RFIDLog_SumBlock>(layout_.sumAddr +
+			(block * RFIDSUM_BLOCK_SIZE));
+
+	return RFIDLog_SumIsValid(Block) ? RFIDREC_INFO_LAP(Block->info) : 0xFF;
+}
+
+/**
+  * @brief  Find the oldest summary block and the number of blocks in use
+  */
+void Image::loadSummaries()
+{
+	const uint16_t Blocks = layout_.sumBlocks;
+	uint16_t Head = 0;
+	uint8_t Lap = (Blocks > 0) ? sumLap(0) : 0xFF;
+
+	if (Lap != 0xFF)
+	{
+		uint16_t Lo = 1;
+		uint16_t Hi = Blocks;
+		while (Lo < Hi)
+		{
+			uint16_t Mid = Lo + ((Hi - Lo) / 2);
+			if (sumLap(Mid) == Lap)
+			{
+				Lo = Mid + 1;
+			}
+			else
+			{
+				Hi = Mid;
+			}
+		}
+		Head = Lo;
+	}
+
+	/* Blocks above the head are of the previous lap once the ring wrapped,
+	 * the one right above may be torn */
+	sumOldest_ = 0;
+	sumCount_ = Head;
+	if (Head < Blocks && (sumLap(Head) != 0xFF ||
+			(Head + 1 < Blocks && sumLap(Head + 1) != 0xFF)))
+	{
+		sumOldest_ = Head;
+		sumCount_ = Blocks;
+	}
+}
+
+/**
+  * @brief  Decode the record with sequence number seq
+  * @retval SLOT_OK, SLOT_DAMAGED or SLOT_FILLER
+  * @param  buf	Receives compact and legacy records
+  * @param  rec	The record, in the image for 16 byte ring records
+  */
+uint8_t Image::decode(uint32_t seq, RFID_Record &buf, const RFID_Record *&rec) const
+{
+	rec = nullptr;
+
+	if (format_ == Format::Legacy)
+	{
+		const RFID_LegacyLog *Old = at<RFID_LegacyLog>(RFIDLOG_LEGACY_BASE_ADDR +
+				(seq * RFIDLOG_LEGACY_SIZE));
+
+		std::memset(buf.uid, 0, RFIDREC_UID_MAX);
+		std::memcpy(buf.uid, Old->uid, sizeof(Old->uid));
+		buf.info = RFIDREC_INFO(Old->status, sizeof(Old->uid));
+		buf.stamp = RFIDREC_STAMP(Old->year, Old->month, Old->day, Old->hour,
+				Old->minute, Old->second);
+		buf.crc = RFIDRec_Checksum(&buf);
+		rec = &buf;
+		return SLOT_OK;
+	}
+
+	uint16_t Slot = (uint16_t)(seq % layout_.capacity);
+	if (format_ == Format::Ring)
+	{
+		const RFID_Record *Rec = at<RFID_Record>(slotAddr(Slot));
+		if (!RFIDRec_IsValid(Rec))
+		{
+			return SLOT_DAMAGED;
+		}
+		rec = Rec;
+		return SLOT_OK;
+	}
+
+	/* Compact: deltas chain from the base through every event up to this one */
+	const RFID_CompactBase *Base = at<RFID_CompactBase>(blockAddr(Slot));
+	if (!RFIDCmp_BaseIsValid(Base))
+	{
+		return SLOT_DAMAGED;
+	}
+	uint32_t Sec = RFIDRec_StampToSeconds(Base->stamp);
+	uint32_t Event = 0;
+	for (uint16_t i = Slot - (Slot % layout_.blockSlots); i <= Slot; i++)
+	{
+		Event = *at<uint32_t>(slotAddr(i));
+		if (!RFIDCmp_EventIsValid(Event))
+		{
+			return SLOT_DAMAGED;
+		}
+		Sec += RFIDCMP_EVENT_DELTA(Event);
+	}
+
+	uint16_t Roster = RFIDCMP_EVENT_ROSTER(Event);
+	if (Roster == RFIDCMP_ROSTER_VOID)
+	{
+		return SLOT_FILLER;
+	}
+	if (Roster >= rosterCount_)
+	{
+		return SLOT_DAMAGED;
+	}
+	const RFID_Record *Entry = at<RFID_Record>(layout_.rosterAddr +
+			(Roster * RFIDREC_SIZE));
+	buf = *Entry;
+	buf.info = RFIDREC_INFO(RFIDCMP_EVENT_STATUS(Event),
+			RFIDREC_INFO_UID_SIZE(Entry->info));
+	buf.stamp = RFIDRec_SecondsToStamp(Sec);
+	buf.crc = RFIDRec_Checksum(&buf);
+	rec = &buf;
+	return SLOT_OK;
+}
+
+/**
+  * @brief  Summary block pos blocks from the oldest one, nullptr if damaged
+  */
+const RFIDLog_SumBlock *Image::summaryBlock(uint32_t pos) const
+{
+	const RFIDLog_SumBlock *Block = at<RFIDLog_SumBlock>(layout_.sumAddr +
+			(((sumOldest_ + pos) % layout_.sumBlocks) * RFIDSUM_BLOCK_SIZE));
+
+	return RFIDLog_SumIsValid(Block) ? Block : nullptr;
+}
+
+Range<RecordIterator> Image::records() const
+{
+	return { RecordIterator(this, first_, headSeq_),
+			 RecordIterator(this, headSeq_, headSeq_) };
+}
+
+Range<SummaryIterator> Image::summaries() const
+{
+	return { SummaryIterator(this, 0),
+			 SummaryIterator(this, (uint32_t)sumCount_ * RFIDSUM_ENTRIES) };
+}
+
+/**
+  * @brief  Records in the log that failed their CRC
+  */
+uint32_t Image::damaged() const
+{
+	uint32_t Count = 0;
+	RFID_Record Buf;
+	const RFID_Record *Rec;
+
+	for (uint32_t Seq = first_; Seq < headSeq_; Seq++)
+	{
+		Count += (decode(Seq, Buf, Rec) == SLOT_DAMAGED);
+	}
+	return Count;
+}
+
+/**
+  * @brief  Every record of a UID, oldest first
+  * @param  uidSize	4, 7 or 10 byte
+  */
+std::vector<Match> Image::find(const uint8_t *uid, uint8_t uidSize) const
+{
+	std::vector<Match> Found;
+
+	for (const Record &R : records())
+	{
+		/* A damaged slot has no UID to compare */
+		if (R.rec != nullptr &&
+				RFIDREC_INFO_UID_SIZE(R.rec->info) == uidSize &&
+				std::memcmp(R.rec->uid, uid, uidSize) == 0)
+		{
+			Found.push_back(Match{ R.seq, R.slot, *R.rec });
+		}
+	}
+	return Found;
+}
+
+}	// namespace rfidlog
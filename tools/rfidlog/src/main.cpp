@@ -0,0 +1,295 @@
+/**
+  ******************************************************************************
+  * @file    main.cpp
+  * @brief   rfidlog: decode attendance log EEPROM images
+  ******************************************************************************
+  * @attention
+  * Usage:
+  *		rfidlog info IMAGE...
+  *		rfidlog records [-o FILE] [-b] IMAGE...
+  *		rfidlog summaries [-o FILE] IMAGE...
+  *		rfidlog find UID [-o FILE] IMAGE...
+  *		Images are decoded in parallel (-j), output keeps the argument order.
+  *		A broken image is reported on stderr and the batch goes on, the exit
+  *		status is 1 if any image failed.
+  *
+  ******************************************************************************
+  */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rfidlog/export.hpp"
+#include "rfidlog/image.hpp"
+
+using namespace rfidlog;
+
+namespace
+{
+
+enum class Command
+{
+	Info,
+	Records,
+	Summaries,
+	Find
+};
+
+struct Options
+{
+	Command command = Command::Info;
+	std::string output;
+	bool binary = false;
+	unsigned jobs = 0;
+	uint8_t uid[RFIDREC_UID_MAX] = {};
+	uint8_t uidSize = 0;
+	std::vector<std::string> images;
+};
+
+/* Output of one image, or the reason it could not be decoded */
+struct Result
+{
+	std::string text;
+	std::string error;
+};
+
+void Usage()
+{
+	std::fputs(
+		"usage: rfidlog info IMAGE...\n"
+		"       rfidlog records [-o FILE] [-b] IMAGE...\n"
+		"       rfidlog summaries [-o FILE] IMAGE...\n"
+		"       rfidlog find UID [-o FILE] IMAGE...\n"
+		"  -o FILE  write to FILE instead of stdout\n"
+		"  -b       records as 16 byte RFID_Record entries instead of CSV\n"
+		"  -j N     decode N images at a time (default: one per CPU)\n"
+		"  UID      4, 7 or 10 byte in hex, e.g. 04:A1:B2:C3\n", stderr);
+	std::exit(2);
+}
+
+Options ParseArgs(int argc, char **argv)
+{
+	Options Opt;
+	int i = 1;
+
+	if (argc < 2)
+	{
+		Usage();
+	}
+	std::string Name = argv[i++];
+	if (Name == "info")
+	{
+		Opt.command = Command::Info;
+	}
+	else if (Name == "records")
+	{
+		Opt.command = Command::Records;
+	}
+	else if (Name == "summaries")
+	{
+		Opt.command = Command::Summaries;
+	}
+	else if (Name == "find" && i < argc)
+	{
+		Opt.command = Command::Find;
+		if (!parseUid(argv[i++], Opt.uid, Opt.uidSize))
+		{
+			std::fprintf(stderr, "rfidlog: bad UID '%s'\n", argv[i - 1]);
+			std::exit(2);
+		}
+	}
+	else
+	{
+		Usage();
+	}
+
+	for (; i < argc; i++)
+	{
+		std::string Arg = argv[i];
+		if (Arg == "-o" && i + 1 < argc)
+		{
+			Opt.output = argv[++i];
+		}
+		else if (Arg == "-b" && Opt.command == Command::Records)
+		{
+			Opt.binary = true;
+		}
+		else if (Arg == "-j" && i + 1 < argc)
+		{
+			Opt.jobs = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (Arg.size() > 1 && Arg[0] == '-')
+		{
+			Usage();
+		}
+		else
+		{
+			Opt.images.push_back(Arg);
+		}
+	}
+	if (Opt.images.empty())
+	{
+		Usage();
+	}
+	if (Opt.jobs == 0)
+	{
+		Opt.jobs = std::thread::hardware_concurrency();
+		Opt.jobs = (Opt.jobs == 0) ? 1 : Opt.jobs;
+	}
+	return Opt;
+}
+
+void AppendInfo(std::string &out, const std::string &name, const Image &image)
+{
+	char Line[256];
+	const RFIDLog_Layout &L = image.layout();
+
+	if (image.format() == Format::Blank)
+	{
+		std::snprintf(Line, sizeof(Line), "%s: blank\n", name.c_str());
+		out += Line;
+		return;
+	}
+	if (image.format() == Format::Legacy)
+	{
+		std::snprintf(Line, sizeof(Line),
+				"%s: legacy layout, counter at 0x%04X = %u records\n",
+				name.c_str(), RFIDLOG_LEGACY_COUNT_ADDR, (unsigned)image.count());
+		out += Line;
+		return;
+	}
+
+	const RFIDLog_Header &H = image.header();
+	std::snprintf(Line, sizeof(Line),
+			"%s: %s layout %u, %u bytes on %u device(s), header update %u\n",
+			name.c_str(), formatName(image.format()), H.layout,
+			(unsigned)image.logSize(), image.devices(), H.update);
+	out += Line;
+	std::snprintf(Line, sizeof(Line),
+			"  records  %u of %u, seq %u..%u, pass %u, head slot %u%s\n",
+			(unsigned)image.count(), L.capacity, (unsigned)image.firstSeq(),
+			(unsigned)image.headSeq(), H.pass, image.head(),
+			image.torn() ? ", torn write at the head" : "");
+	out += Line;
+	std::snprintf(Line, sizeof(Line), "  damaged  %u\n", (unsigned)image.damaged());
+	out += Line;
+	std::snprintf(Line, sizeof(Line),
+			"  summary  %u of %u blocks at 0x%04X\n", (unsigned)image.summaryBlocks(),
+			L.sumBlocks, L.sumAddr);
+	out += Line;
+	std::snprintf(Line, sizeof(Line),
+			"  regions  directory %u at 0x%04X, day index %u at 0x%04X\n",
+			L.dirSlots, L.dirAddr, L.daySlots, L.dayAddr);
+	out += Line;
+	if (image.format() == Format::Compact)
+	{
+		std::snprintf(Line, sizeof(Line), "  roster   %u of %u at 0x%04X\n",
+				image.rosterCount(), L.rosterSize, L.rosterAddr);
+		out += Line;
+	}
+}
+
+Result Decode(const Options &opt, const std::string &name)
+{
+	Result R;
+
+	try
+	{
+		Image Img(name);
+		switch (opt.command)
+		{
+		case Command::Info:
+			AppendInfo(R.text, name, Img);
+			break;
+		case Command::Records:
+			if (opt.binary)
+			{
+				appendRecordsBinary(R.text, Img);
+			}
+			else
+			{
+				appendRecordsCsv(R.text, name, Img);
+			}
+			break;
+		case Command::Summaries:
+			appendSummariesCsv(R.text, name, Img);
+			break;
+		case Command::Find:
+			for (const Match &M : Img.find(opt.uid, opt.uidSize))
+			{
+				appendRecordCsv(R.text, name, Record{ M.seq, M.slot, &M.rec });
+			}
+			break;
+		}
+	}
+	catch (const std::exception &e)
+	{
+		R.text.clear();
+		R.error = name + ": " + e.what();
+	}
+	return R;
+}
+
+}	// namespace
+
+int main(int argc, char **argv)
+{
+	Options Opt = ParseArgs(argc, argv);
+	std::FILE *Out = stdout;
+	int Status = 0;
+
+	if (!Opt.output.empty())
+	{
+		Out = std::fopen(Opt.output.c_str(), Opt.binary ? "wb" : "w");
+		if (Out == nullptr)
+		{
+			std::perror(Opt.output.c_str());
+			return 1;
+		}
+	}
+
+	std::string Header;
+	if ((Opt.command == Command::Records && !Opt.binary) ||
+			Opt.command == Command::Find)
+	{
+		appendRecordsCsvHeader(Header);
+	}
+	else if (Opt.command == Command::Summaries)
+	{
+		appendSummariesCsvHeader(Header);
+	}
+	std::fwrite(Header.data(), 1, Header.size(), Out);
+
+	/* At most jobs images in flight, written out in argument order */
+	std::deque<std::future<Result>> Pending;
+	size_t Next = 0;
+	while (Next < Opt.images.size() || !Pending.empty())
+	{
+		while (Next < Opt.images.size() && Pending.size() < Opt.jobs)
+		{
+			Pending.push_back(std::async(std::launch::async, Decode,
+					std::cref(Opt), std::cref(Opt.images[Next++])));
+		}
+		Result R = Pending.front().get();
+		Pending.pop_front();
+		if (!R.error.empty())
+		{
+			std::fprintf(stderr, "rfidlog: %s\n", R.error.c_str());
+			Status = 1;
+		}
+		std::fwrite(R.text.data(), 1, R.text.size(), Out);
+	}
+
+	if (Out != stdout && std::fclose(Out) != 0)
+	{
+		std::perror(Opt.output.c_str());
+		Status = 1;
+	}
+	return Status;
+}
@@ -0,0 +1,87 @@
+/**
+  ******************************************************************************
+  * @file    mapped_file.cpp
+  * @brief   Read-only memory mapping of an EEPROM image (POSIX)
+  ******************************************************************************
+  */
+#include "rfidlog/mapped_file.hpp"
+
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace rfidlog
+{
+
+MappedFile::MappedFile(const std::string &path)
+{
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		throw std::system_error(errno, std::generic_category());
+	}
+
+	struct stat st;
+	if (::fstat(fd, &st) != 0)
+	{
+		int err = errno;
+		::close(fd);
+		throw std::system_error(err, std::generic_category());
+	}
+
+	/* An empty file cannot be mapped, it decodes as a blank image */
+	size_ = static_cast<size_t>(st.st_size);
+	if (size_ > 0)
+	{
+		void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED)
+		{
+			int err = errno;
+			::close(fd);
+			throw std::system_error(err, std::generic_category());
+		}
+		/* Scans run front to back */
+		::madvise(p, size_, MADV_SEQUENTIAL);
+		data_ = static_cast<const uint8_t *>(p);
+	}
+	::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+	release();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+	: data_(std::exchange(other.data_, nullptr)),
+	  size_(std::exchange(other.size_, 0))
+{
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+	if (this != &other)
+	{
+		release();
+		data_ = std::exchange(other.data_, nullptr);
+		size_ = std::exchange(other.size_, 0);
+	}
+	return *this;
+}
+
+void MappedFile::release()
+{
+	if (data_ != nullptr)
+	{
+		::munmap(const_cast<uint8_t *>(data_), size_);
+		data_ = nullptr;
+		size_ = 0;
+	}
+}
+
+}	// namespace rfidlog
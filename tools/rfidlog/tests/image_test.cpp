@@ -0,0 +1,370 @@
+/**
+  ******************************************************************************
+  * @file    image_test.cpp
+  * @brief   Decoder checks against EEPROM images built in memory
+  ******************************************************************************
+  * @attention
+  * Each image is written with the firmware's own structs and checksums from
+  * rfid_record.h, the way RFIDLog_Append() and the roll-up leave the EEPROM:
+  * empty, legacy, 4 KB, 7 and 10 byte UIDs, a torn page at the head, 32 KB
+  * with both rings wrapped and 64 KB compact.
+  * Exits with the number of failed checks.
+  *
+  ******************************************************************************
+  */
+#include "rfidlog/image.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+using namespace rfidlog;
+
+static int failures;
+
+static void Check(bool ok, const char *image, const char *what)
+{
+	if (!ok)
+	{
+		std::fprintf(stderr, "%s: %s\n", image, what);
+		failures++;
+	}
+}
+
+#define CHECK(image, cond)	Check((cond), (image), #cond)
+
+/* Builder -------------------------------------------------------------------*/
+class Builder
+{
+public:
+	Builder(uint32_t size, uint8_t bits, bool compact)
+		: bytes(size, 0xFF)
+	{
+		RFIDLog_MakeLayout(&layout, size, RFIDLog_PageSize(size), compact);
+		hdr_.magic = RFIDLOG_MAGIC;
+		hdr_.layout = compact ? RFIDLOG_LAYOUT_COMPACT : RFIDLOG_LAYOUT;
+		hdr_.recordSize = compact ? RFIDCMP_EVENT_SIZE : RFIDREC_SIZE;
+		hdr_.geometry = RFIDLOG_GEOMETRY(bits, 1);
+	}
+
+	void header(uint16_t pass, uint32_t start)
+	{
+		hdr_.pass = pass;
+		hdr_.start = start;
+		hdr_.update = 1;
+		hdr_.crc = RFIDLog_HeaderChecksum(&hdr_);
+		std::memcpy(&bytes[RFIDLOG_HEADER_ADDR], &hdr_, sizeof(hdr_));
+	}
+
+	/* 16 byte ring record written in lap pass, UID bytes past the fourth
+	 * are 0x10 + index */
+	void record(uint16_t slot, uint16_t pass, uint8_t uid, uint32_t stamp,
+			uint8_t uidSize = 4)
+	{
+		RFID_Record Rec;
+
+		std::memset(&Rec, 0, sizeof(Rec));
+		Rec.uid[0] = uid;
+		Rec.uid[1] = 0xA5;
+		for (uint8_t i = 4; i < uidSize; i++)
+		{
+			Rec.uid[i] = 0x10 + i;
+		}
+		Rec.info = RFIDREC_INFO_WITH_LAP(RFIDREC_INFO(1, uidSize), pass);
+		Rec.stamp = stamp;
+		Rec.crc = RFIDRec_Checksum(&Rec);
+		std::memcpy(&bytes[RFIDLOG_BASE_ADDR + (slot * RFIDREC_SIZE)], &Rec,
+				sizeof(Rec));
+	}
+
+	void rosterEntry(uint16_t index, uint8_t uid)
+	{
+		RFID_Record Rec;
+
+		std::memset(&Rec, 0, sizeof(Rec));
+		Rec.uid[0] = uid;
+		Rec.uid[1] = 0xA5;
+		Rec.info = RFIDREC_INFO(0, 4);
+		Rec.crc = RFIDRec_Checksum(&Rec);
+		std::memcpy(&bytes[layout.rosterAddr + (index * RFIDREC_SIZE)], &Rec,
+				sizeof(Rec));
+	}
+
+	/* Compact block of pass 0: base stamp, then one event per roster index */
+	void compactBlock(uint16_t block, uint32_t stamp,
+			const std::vector<uint16_t> &roster)
+	{
+		RFID_CompactBase Base;
+		uint32_t Addr = RFIDLOG_BASE_ADDR + (block * RFIDLOG_RING_BLOCK);
+
+		std::memset(&Base, 0, sizeof(Base));
+		Base.info = RFIDREC_INFO_WITH_LAP(RFIDCMP_VERSION << 6, 0);
+		Base.stamp = stamp;
+		Base.crc = RFIDCmp_BaseChecksum(&Base);
+		std::memcpy(&bytes[Addr], &Base, sizeof(Base));
+		for (size_t i = 0; i < roster.size(); i++)
+		{
+			uint32_t Event = RFIDCmp_MakeEvent(0, 1, roster[i], 60);
+			std::memcpy(&bytes[Addr + RFIDCMP_BASE_SIZE +
+					(i * RFIDCMP_EVENT_SIZE)], &Event, sizeof(Event));
+		}
+	}
+
+	/* Summary block of lap, entries = 1 leaves the second one unused */
+	void summary(uint16_t block, uint8_t lap, uint16_t date, uint8_t entries)
+	{
+		RFIDLog_SumBlock Block;
+
+		std::memset(&Block, 0xFF, sizeof(Block));
+		Block.date = date;
+		for (uint8_t i = 0; i < entries; i++)
+		{
+			std::memset(Block.entry[i].uid, 0, RFIDREC_UID_MAX);
+			Block.entry[i].uid[0] = i;
+			Block.entry[i].first = RFIDSUM_FIRST(4, 480);
+			Block.entry[i].last = 1020;
+		}
+		Block.info = RFIDREC_INFO_WITH_LAP(RFIDSUM_VERSION << 6, lap);
+		Block.crc = RFIDLog_SumChecksum(&Block);
+		std::memcpy(&bytes[layout.sumAddr + (block * RFIDSUM_BLOCK_SIZE)],
+				&Block, sizeof(Block));
+	}
+
+	std::vector<uint8_t> bytes;
+	RFIDLog_Layout layout = {};
+
+private:
+	RFIDLog_Header hdr_ = {};
+};
+
+static uint32_t CountRecords(const Image &image)
+{
+	uint32_t Count = 0;
+
+	for (const Record &R : image.records())
+	{
+		Count += (R.rec != nullptr);
+	}
+	return Count;
+}
+
+static uint32_t CountSummaries(const Image &image)
+{
+	uint32_t Count = 0;
+
+	for (const Summary &S : image.summaries())
+	{
+		Count += (S.uidSize == 4);
+	}
+	return Count;
+}
+
+/* Images --------------------------------------------------------------------*/
+static void TestEmpty()
+{
+	std::vector<uint8_t> Bytes(0x1000, 0xFF);
+	Image Img(Bytes.data(), Bytes.size());
+
+	CHECK("empty", Img.format() == Format::Blank);
+	CHECK("empty", Img.count() == 0);
+	CHECK("empty", CountRecords(Img) == 0);
+	CHECK("empty", CountSummaries(Img) == 0);
+
+	/* An empty file, as the mapping leaves it */
+	Image None(nullptr, 0);
+
+	CHECK("empty", None.format() == Format::Blank);
+	CHECK("empty", None.count() == 0);
+}
+
+static void TestLegacy()
+{
+	std::vector<uint8_t> Bytes(0x1000, 0xFF);
+	const uint16_t Count = 5;
+
+	std::memcpy(&Bytes[RFIDLOG_LEGACY_COUNT_ADDR], &Count, sizeof(Count));
+	for (uint16_t i = 0; i < Count; i++)
+	{
+		RFID_LegacyLog Old = { 26, 3, 14, 8, (uint8_t)i, 0, { 0xDE, 0xAD, 0xBE,
+				0xEF, (uint8_t)i }, 1 };
+		std::memcpy(&Bytes[RFIDLOG_LEGACY_BASE_ADDR + (i * RFIDLOG_LEGACY_SIZE)],
+				&Old, sizeof(Old));
+	}
+	Image Img(Bytes.data(), Bytes.size());
+
+	CHECK("legacy", Img.format() == Format::Legacy);
+	CHECK("legacy", Img.count() == Count);
+	CHECK("legacy", CountRecords(Img) == Count);
+	CHECK("legacy", CountSummaries(Img) == 0);
+	const uint8_t Uid[4] = { 0xDE, 0xAD, 0xBE, 0xEF };
+	CHECK("legacy", Img.find(Uid, 4).size() == Count);
+}
+
+static void Test4K()
+{
+	Builder B(0x1000, 12, false);
+	const uint16_t Count = 10;
+
+	B.header(0, 0);
+	for (uint16_t i = 0; i < Count; i++)
+	{
+		B.record(i, 0, (uint8_t)(i % 3), RFIDREC_STAMP(26, 3, 14, 8, i, 0));
+	}
+	B.summary(0, 0, 9569, 2);
+	B.summary(1, 0, 9570, 2);
+	B.summary(2, 0, 9571, 1);
+	Image Img(B.bytes.data(), B.bytes.size());
+
+	CHECK("4K", Img.format() == Format::Ring);
+	CHECK("4K", Img.logSize() == 0x1000);
+	CHECK("4K", Img.head() == Count);
+	CHECK("4K", Img.count() == Count);
+	CHECK("4K", CountRecords(Img) == Count);
+	CHECK("4K", Img.summaryBlocks() == 3);
+	CHECK("4K", CountSummaries(Img) == 5);
+	CHECK("4K", !Img.torn());
+}
+
+static void TestUidSizes()
+{
+	Builder B(0x1000, 12, false);
+	const uint8_t Sizes[3] = { 4, 7, 10 };
+
+	/* Each UID starts with the shorter one, only the size tells them apart */
+	B.header(0, 0);
+	for (uint16_t i = 0; i < 9; i++)
+	{
+		B.record(i, 0, 0x42, RFIDREC_STAMP(26, 3, 14, 8, i, 0), Sizes[i % 3]);
+	}
+	Image Img(B.bytes.data(), B.bytes.size());
+
+	CHECK("uid", Img.count() == 9);
+	const uint8_t Uid4[4] = { 0x42, 0xA5, 0, 0 };
+	const uint8_t Uid7[7] = { 0x42, 0xA5, 0, 0, 0x14, 0x15, 0x16 };
+	const uint8_t Uid10[10] = { 0x42, 0xA5, 0, 0, 0x14, 0x15, 0x16, 0x17, 0x18,
+			0x19 };
+	std::vector<Match> Found = Img.find(Uid7, 7);
+	CHECK("uid", Found.size() == 3);
+	CHECK("uid", !Found.empty() && Found.front().slot == 1);
+	CHECK("uid", !Found.empty() && Found.back().seq == 7);
+	Found = Img.find(Uid10, 10);
+	CHECK("uid", Found.size() == 3);
+	CHECK("uid", !Found.empty() && Found.front().rec.uid[9] == 0x19);
+	Found = Img.find(Uid4, 4);
+	CHECK("uid", Found.size() == 3);
+	CHECK("uid", !Found.empty() && Found.front().slot == 0);
+	Found = Img.find(Uid10, 7);
+	CHECK("uid", !Found.empty() && Found.front().slot == 1);
+}
+
+static void TestTorn()
+{
+	Builder B(0x1000, 12, false);
+	const uint16_t Capacity = B.layout.capacity;
+	const uint16_t Head = 10;
+
+	/* Second pass, power lost while writing the page of slots Head - 2 and
+	 * Head - 1: the second record made it, the first one did not */
+	B.header(1, 0);
+	for (uint16_t i = 0; i < Capacity; i++)
+	{
+		B.record(i, (i < Head) ? 1 : 0, (uint8_t)i, RFIDREC_STAMP(26, 3, 14,
+				8 + (i / 60), i % 60, 0));
+	}
+	B.bytes[RFIDLOG_BASE_ADDR + ((Head - 2) * RFIDREC_SIZE) + 1] ^= 0x01;
+	Image Img(B.bytes.data(), B.bytes.size());
+
+	CHECK("torn", Img.torn());
+	CHECK("torn", Img.head() == Head - 2);
+	CHECK("torn", Img.headSeq() == (uint32_t)Capacity + Head - 2);
+	/* The page is rewritten from its start, the old records in it are lost */
+	CHECK("torn", Img.firstSeq() == Head);
+	CHECK("torn", Img.count() == Capacity - 2U);
+	CHECK("torn", CountRecords(Img) == Capacity - 2U);
+	CHECK("torn", Img.damaged() == 0);
+	const uint8_t Lost[4] = { (uint8_t)(Head - 1), 0xA5, 0, 0 };
+	CHECK("torn", Img.find(Lost, 4).empty());
+	const uint8_t Kept[4] = { (uint8_t)(Head - 3), 0xA5, 0, 0 };
+	CHECK("torn", Img.find(Kept, 4).size() == 1);
+}
+
+static void Test32K()
+{
+	Builder B(0x8000, 15, false);
+	const uint16_t Capacity = B.layout.capacity;
+	const uint16_t Head = 100;
+	const uint16_t SumHead = 10;
+
+	/* Second pass over the ring, the summaries wrapped once as well */
+	B.header(1, 0);
+	for (uint16_t i = 0; i < Capacity; i++)
+	{
+		B.record(i, (i < Head) ? 1 : 0, (uint8_t)i, RFIDREC_STAMP(26, 3, 14,
+				8 + (i / 60), i % 60, 0));
+	}
+	for (uint16_t i = 0; i < B.layout.sumBlocks; i++)
+	{
+		B.summary(i, (i < SumHead) ? 1 : 0, 9000 + i, 2);
+	}
+	Image Img(B.bytes.data(), B.bytes.size());
+
+	CHECK("32K", Img.format() == Format::Ring);
+	CHECK("32K", Img.head() == Head);
+	CHECK("32K", Img.headSeq() == (uint32_t)Capacity + Head);
+	CHECK("32K", Img.count() == Capacity);
+	CHECK("32K", CountRecords(Img) == Capacity);
+	CHECK("32K", Img.summaryBlocks() == B.layout.sumBlocks);
+	CHECK("32K", CountSummaries(Img) == 2U * B.layout.sumBlocks);
+	CHECK("32K", Img.summaries().begin()->date == 9000 + SumHead);
+	CHECK("32K", Img.damaged() == 0);
+}
+
+static void Test64KCompact()
+{
+	Builder B(0x10000, 16, true);
+
+	/* Two UIDs tapping in turn, one filler event ends the second block */
+	B.header(0, 0);
+	B.rosterEntry(0, 0x11);
+	B.rosterEntry(1, 0x22);
+	B.compactBlock(0, RFIDREC_STAMP(26, 3, 14, 8, 0, 0), { 0, 1, 0, 1, 0, 1 });
+	B.compactBlock(1, RFIDREC_STAMP(26, 3, 14, 9, 0, 0),
+			{ 0, 1, RFIDCMP_ROSTER_VOID });
+	B.summary(0, 0, 9569, 2);
+	Image Img(B.bytes.data(), B.bytes.size());
+
+	CHECK("64K", Img.format() == Format::Compact);
+	CHECK("64K", Img.logSize() == 0x10000);
+	CHECK("64K", Img.rosterCount() == 2);
+	CHECK("64K", Img.head() == RFIDCMP_EVENTS + 3);
+	CHECK("64K", Img.count() == RFIDCMP_EVENTS + 3);
+	CHECK("64K", CountRecords(Img) == RFIDCMP_EVENTS + 2);
+	CHECK("64K", CountSummaries(Img) == 2);
+	const uint8_t Uid[4] = { 0x11, 0xA5, 0, 0 };
+	CHECK("64K", Img.find(Uid, 4).size() == 4);
+}
+
+int main()
+{
+	try
+	{
+		TestEmpty();
+		TestLegacy();
+		Test4K();
+		TestUidSizes();
+		TestTorn();
+		Test32K();
+		Test64KCompact();
+	}
+	catch (const std::exception &e)
+	{
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+	if (failures == 0)
+	{
+		std::printf("all images decoded as expected\n");
+	}
+	return failures;
+}